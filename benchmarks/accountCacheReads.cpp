@@ -0,0 +1,62 @@
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "accountCache.hpp"
+#include "mango_v3.hpp"
+
+const int ITERATIONS = 1000000;
+
+/// @brief read a cached account ITERATIONS times
+/// @return average time in nanoseconds per read
+template <typename T>
+double measure(const typename solana::rpc::subscription::AccountCache<
+               T>::Handle &handle) {
+  typename solana::rpc::subscription::AccountCache<T>::Entry entry;
+  uint64_t sink = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERATIONS; ++i) {
+    handle.get(entry);
+    sink += entry.context.slot;
+  }
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (sink == 1) spdlog::debug("sink {}", sink);
+  return elapsed.count() / ITERATIONS;
+}
+
+/// @brief read latency of a cached account, idle and while it is updated
+template <typename T>
+void compare(const std::string &name) {
+  solana::rpc::subscription::AccountCache<T> cache;
+  const auto key = solana::PublicKey::empty();
+  const auto handle = cache.track(key);
+  typename solana::rpc::subscription::AccountCache<T>::Entry entry{};
+  cache.update(key, entry);
+  const auto idle = measure<T>(handle);
+
+  // a writer publishing a new slot as fast as it can
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    auto next = entry;
+    while (!done.load()) {
+      next.context.slot++;
+      cache.update(key, next);
+    }
+  });
+  const auto contended = measure<T>(handle);
+  done.store(true);
+  writer.join();
+
+  spdlog::info("{} ({} bytes)", name, sizeof(T));
+  spdlog::info("  read:                 {:.1f} ns", idle);
+  spdlog::info("  read during updates:  {:.1f} ns", contended);
+}
+
+int main() {
+  compare<mango_v3::MangoCache>("MangoCache");
+  compare<mango_v3::MangoGroup>("MangoGroup");
+}
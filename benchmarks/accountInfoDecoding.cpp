@@ -0,0 +1,70 @@
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "mango_v3.hpp"
+#include "solana.hpp"
+
+using json = nlohmann::json;
+
+const int ITERATIONS = 2000;
+
+/// @brief getAccountInfo response body for an account of random data
+template <typename T>
+std::string responseBody() {
+  std::mt19937 gen(42);
+  std::string data(sizeof(T), '\0');
+  for (auto &c : data) c = static_cast<char>(gen());
+  return R"({"jsonrpc":"2.0","result":{"context":{"slot":134045296},)"
+         R"("value":{"data":[")" +
+         solana::b64encode(data) +
+         R"(","base64"],"executable":false,"lamports":30791040,)"
+         R"("owner":"mv3ekLzLbnVPNxjSKvqBpU3ZeZXPQdEC3bp5MDEBG68",)"
+         R"("rentEpoch":226}},"id":1})";
+}
+
+/// @brief run decode ITERATIONS times
+/// @return average time in microseconds per decode
+template <typename Decode>
+double measure(const Decode &decode) {
+  uint8_t sink = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERATIONS; ++i) {
+    const auto res = decode();
+    sink ^= reinterpret_cast<const uint8_t *>(&res.value->data)[i % 64];
+  }
+  const std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  // keep the decoded data alive
+  if (sink == 0xff) spdlog::debug("sink {}", sink);
+  return elapsed.count() / ITERATIONS;
+}
+
+template <typename T>
+void compare(const std::string &name) {
+  const auto body = responseBody<T>();
+  // previous implementation: json DOM, base64 string, memcpy
+  const auto dom = [&]() {
+    return solana::rpc::accountInfoFromResult<T>(json::parse(body)["result"]);
+  };
+  const auto direct = [&]() {
+    return solana::decodeAccountInfoResponse<T>(body);
+  };
+  const auto expected = dom();
+  const auto decoded = direct();
+  if (memcmp(&expected.value->data, &decoded.value->data, sizeof(T)) != 0)
+    throw std::runtime_error("decoded data differs for " + name);
+
+  spdlog::info("{} ({} bytes)", name, sizeof(T));
+  spdlog::info("  from_json:                 {:.1f} us", measure(dom));
+  spdlog::info("  decodeAccountInfoResponse: {:.1f} us", measure(direct));
+}
+
+int main() {
+  compare<mango_v3::MangoAccountInfo>("MangoAccountInfo");
+  compare<mango_v3::MangoCache>("MangoCache");
+  compare<mango_v3::EventQueue>("EventQueue");
+}
@@ -0,0 +1,43 @@
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <future>
+#include <vector>
+
+#include "localRpcServer.hpp"
+#include "solana.hpp"
+
+// getSlot like response of a rpc node
+const std::string RESPONSE = R"({"jsonrpc":"2.0","result":42,"id":1})";
+const auto LATENCY = std::chrono::milliseconds(5);
+const int REQUESTS = 1000;
+
+/// @brief run fn once on the calling thread
+/// @return requests per second
+double measure(const std::function<void()> &fn) {
+  const auto start = std::chrono::steady_clock::now();
+  fn();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return REQUESTS / elapsed.count();
+}
+
+int main() {
+  LocalRpcServer server(RESPONSE, LATENCY);
+  const auto connection = solana::rpc::Connection(server.url());
+
+  spdlog::info("{} getSlot requests, {}ms rpc latency", REQUESTS,
+               LATENCY.count());
+  // one request after the other, the thread waits on every round trip
+  spdlog::info("  getSlot:      {:.0f} requests/s", measure([&]() {
+                 for (int i = 0; i < REQUESTS; ++i) connection.getSlot();
+               }));
+  // all requests in flight at once, sent from the same thread
+  spdlog::info("  getSlotAsync: {:.0f} requests/s", measure([&]() {
+                 std::vector<std::future<uint64_t>> slots;
+                 slots.reserve(REQUESTS);
+                 for (int i = 0; i < REQUESTS; ++i)
+                   slots.push_back(connection.getSlotAsync());
+                 for (auto &slot : slots) slot.get();
+               }));
+}
@@ -0,0 +1,63 @@
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "solana.hpp"
+
+const int ITERATIONS = 200;
+
+/// @brief run f on every key ITERATIONS times
+/// @return average time in nanoseconds per key
+template <typename F>
+double measure(size_t keys, const F &f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERATIONS; ++i) f();
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / ITERATIONS / keys;
+}
+
+int main() {
+  std::mt19937 gen(42);
+  std::vector<solana::PublicKey> keys(1000);
+  std::vector<std::string> encoded;
+  for (auto &key : keys) {
+    for (auto &b : key.data) b = static_cast<uint8_t>(gen());
+    encoded.push_back(key.toBase58());
+  }
+  size_t sink = 0;
+
+  // previous implementation: b58enc/b58tobin on variable length arrays
+  const auto b58enc = measure(keys.size(), [&]() {
+    for (const auto &key : keys) sink += solana::b58encode(key.data).size();
+  });
+  const auto b58tobin = measure(keys.size(), [&]() {
+    for (const auto &b58 : encoded) {
+      solana::PublicKey key;
+      size_t size = key.SIZE;
+      solana::b58tobin(key.data.data(), &size, b58.c_str(), b58.size());
+      sink += key.data[0];
+    }
+  });
+  const auto encode32 = measure(keys.size(), [&]() {
+    for (const auto &key : keys) {
+      char b58[solana::B58_32_MAX_SIZE];
+      sink += key.toBase58(b58);
+    }
+  });
+  const auto decode32 = measure(keys.size(), [&]() {
+    for (const auto &b58 : encoded)
+      sink += solana::PublicKey::fromBase58(b58).data[0];
+  });
+  if (sink == 0) spdlog::debug("sink {}", sink);
+
+  spdlog::info("encode 32 bytes");
+  spdlog::info("  b58enc:      {:.0f} ns", b58enc);
+  spdlog::info("  b58encode32: {:.0f} ns", encode32);
+  spdlog::info("decode 32 bytes");
+  spdlog::info("  b58tobin:    {:.0f} ns", b58tobin);
+  spdlog::info("  b58decode32: {:.0f} ns", decode32);
+}
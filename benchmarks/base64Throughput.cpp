@@ -0,0 +1,54 @@
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "base64.hpp"
+#include "mango_v3.hpp"
+
+const int ITERATIONS = 5000;
+
+/// @brief run f ITERATIONS times
+/// @return throughput in GB/s for bytes of binary data per run
+template <typename F>
+double measure(size_t bytes, const F &f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ITERATIONS; ++i) f();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return bytes * ITERATIONS / elapsed.count() / 1e9;
+}
+
+int main() {
+  // the largest account decoded on the hot path
+  const auto size = sizeof(mango_v3::EventQueue);
+  std::mt19937 gen(42);
+  std::string data(size, '\0');
+  for (auto &c : data) c = static_cast<char>(gen());
+  const auto encoded = solana::b64encode(data);
+  std::string chars(encoded.size(), '\0');
+  std::string bytes(size, '\0');
+
+  spdlog::info("EventQueue ({} bytes, {} base64 chars)", size, encoded.size());
+  const std::pair<solana::B64Kernel, const char *> kernels[] = {
+      {solana::B64Kernel::SCALAR, "scalar"},
+      {solana::B64Kernel::SSE4, "sse4"},
+      {solana::B64Kernel::AVX2, "avx2"}};
+  for (const auto &[kernel, name] : kernels) {
+    if (!solana::b64kernelSupported(kernel)) {
+      spdlog::info("  {:6}: not supported", name);
+      continue;
+    }
+    const auto encode = measure(size, [&]() {
+      solana::b64encode(data.data(), size, &chars[0], kernel);
+    });
+    const auto decode = measure(size, [&]() {
+      solana::b64decode(encoded.data(), encoded.size(), &bytes[0], kernel);
+    });
+    if (chars != encoded || bytes != data)
+      throw std::runtime_error(std::string("round trip failed for ") + name);
+    spdlog::info("  {:6}: encode {:.2f} GB/s, decode {:.2f} GB/s", name, encode,
+                 decode);
+  }
+}
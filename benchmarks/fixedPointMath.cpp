@@ -0,0 +1,57 @@
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "fixedp.h"
+
+const int ITERATIONS = 50;
+const size_t OPERANDS = 10000;
+
+/// @brief random i80f48 with magnitude up to 2^bits
+std::vector<i80f48> operands(std::mt19937_64 &gen, int bits) {
+  std::vector<i80f48> result(OPERANDS);
+  for (auto &value : result) {
+    const auto raw = (static_cast<__int128>(gen()) << 64 | gen()) >>
+                     (127 - 48 - bits);
+    value = i80f48::from_base(raw == 0 ? 1 : raw);
+  }
+  return result;
+}
+
+/// @brief apply op to every pair of operands, ITERATIONS times per round
+/// @return time in nanoseconds per operation of the fastest of 5 rounds
+template <typename Op>
+double measure(const std::vector<i80f48> &lhs, const std::vector<i80f48> &rhs,
+               const Op &op) {
+  i80f48 sink = 0;
+  double best = 0;
+  for (int round = 0; round < 5; ++round) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i)
+      for (size_t j = 0; j < OPERANDS; ++j) sink += op(lhs[j], rhs[j]);
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const auto perOperation = elapsed.count() / ITERATIONS / OPERANDS;
+    if (round == 0 || perOperation < best) best = perOperation;
+  }
+  if (sink == 1) spdlog::debug("sink {}", sink.to_double());
+  return best;
+}
+
+int main() {
+  std::mt19937_64 gen(42);
+  const auto mul = [](i80f48 a, i80f48 b) { return a * b; };
+  const auto div = [](i80f48 a, i80f48 b) { return a / b; };
+  // health math mixes prices and weights (small) with native amounts (large)
+  const auto small = operands(gen, 8);
+  const auto medium = operands(gen, 30);
+  const auto large = operands(gen, 60);
+
+  spdlog::info("i80f48");
+  spdlog::info("  mul:                 {:.1f} ns", measure(medium, small, mul));
+  spdlog::info("  div medium / small:  {:.1f} ns", measure(medium, small, div));
+  spdlog::info("  div large / medium:  {:.1f} ns", measure(large, medium, div));
+  spdlog::info("  div small / large:   {:.1f} ns", measure(small, large, div));
+}
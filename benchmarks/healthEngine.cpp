@@ -0,0 +1,105 @@
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "HealthEngine.hpp"
+#include "HealthTracker.hpp"
+#include "MangoAccount.hpp"
+
+const size_t ACCOUNTS = 10000;
+
+/// @brief time in milliseconds of the fastest of 5 runs of f
+template <typename F>
+double measure(const F &f) {
+  double best = 0;
+  for (int round = 0; round < 5; ++round) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (round == 0 || elapsed.count() < best) best = elapsed.count();
+  }
+  return best;
+}
+
+int main() {
+  // one fixture account with spot, perp and open orders positions, replicated
+  const std::string path = std::string(FIXTURES_DIR) + "/mango_v3/account2";
+  const auto mangoGroup =
+      solana::rpc::fromFile<mango_v3::MangoGroup>(path + "/group.json");
+  const auto mangoCache =
+      solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json");
+  const auto accountInfo =
+      solana::rpc::fromFile<mango_v3::MangoAccountInfo>(path + "/account.json");
+  auto mangoAccount = mango_v3::MangoAccount(accountInfo);
+  mango_v3::HealthEngine::OpenOrdersMap openOrders;
+  for (int i = 0; i < mango_v3::MAX_PAIRS; ++i) {
+    const auto file = path + "/openorders" + std::to_string(i) + ".json";
+    if (!std::ifstream(file).good()) continue;
+    mangoAccount.spotOpenOrdersAccounts[i] =
+        solana::rpc::fromFile<serum_v3::OpenOrders>(file);
+    openOrders[accountInfo.spotOpenOrders[i]] =
+        *mangoAccount.spotOpenOrdersAccounts[i];
+  }
+  const std::vector<mango_v3::MangoAccount> mangoAccounts(ACCOUNTS,
+                                                          mangoAccount);
+  const std::vector<mango_v3::MangoAccountInfo> accounts(ACCOUNTS,
+                                                          accountInfo);
+
+  i80f48 sink = 0;
+  const auto perAccount = measure([&]() {
+    for (const auto &mangoAccount : mangoAccounts) {
+      sink += mangoAccount.getHealth(mangoGroup, mangoCache,
+                                     mango_v3::HealthType::Init);
+      sink += mangoAccount.getHealth(mangoGroup, mangoCache,
+                                     mango_v3::HealthType::Maint);
+    }
+  });
+  const mango_v3::GroupWeights groupWeights(mangoGroup);
+  const auto &initWeights = groupWeights.get<mango_v3::HealthType::Init>();
+  const auto &maintWeights = groupWeights.get<mango_v3::HealthType::Maint>();
+  const auto weightTables = measure([&]() {
+    for (const auto &mangoAccount : mangoAccounts) {
+      sink += mangoAccount.getHealth(mangoGroup, mangoCache, initWeights);
+      sink += mangoAccount.getHealth(mangoGroup, mangoCache, maintWeights);
+    }
+  });
+  const mango_v3::HealthEngine engine(mangoGroup);
+  mango_v3::HealthEngine::Results results;
+  const auto batch = [&](unsigned threads) {
+    return measure([&]() {
+      engine.compute(mangoCache, accounts.data(), accounts.size(), openOrders,
+                     results, threads);
+      sink += results.initHealth.back();
+    });
+  };
+  const auto singleThread = batch(1);
+  const auto allCores = batch(0);
+
+  // an oracle tick moving a single price
+  std::vector<mango_v3::HealthTracker> trackers;
+  for (const auto &mangoAccount : mangoAccounts) {
+    trackers.emplace_back(mangoGroup, groupWeights, mangoAccount, mangoCache);
+  }
+  auto tickCache = mangoCache;
+  const auto incremental = measure([&]() {
+    tickCache.price_cache[0].price *= i80f48(1.001);
+    for (auto &tracker : trackers) {
+      tracker.update(tickCache);
+      sink += tracker.getHealth(mango_v3::HealthType::Init);
+      sink += tracker.getHealth(mango_v3::HealthType::Maint);
+    }
+  });
+  if (sink == 1) spdlog::debug("sink {}", sink.to_double());
+
+  spdlog::info("init + maint health of {} accounts", ACCOUNTS);
+  spdlog::info("  MangoAccount::getHealth:  {:.2f} ms", perAccount);
+  spdlog::info("  with GroupWeights:        {:.2f} ms", weightTables);
+  spdlog::info("  HealthEngine, 1 thread:   {:.2f} ms", singleThread);
+  spdlog::info("  HealthEngine, all cores:  {:.2f} ms ({} threads)", allCores,
+               std::thread::hardware_concurrency());
+  spdlog::info("  HealthTracker, 1 price:   {:.2f} ms", incremental);
+}
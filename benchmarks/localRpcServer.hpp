@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace beast = boost::beast;  // from <boost/beast.hpp>
+namespace http = beast::http;    // from <boost/beast/http.hpp>
+namespace net = boost::asio;     // from <boost/asio.hpp>
+using tcp = boost::asio::ip::tcp;
+
+/// @brief Minimal HTTP/1.1 stand-in for an rpc node, answers every request
+/// with the same body and honors keep-alive
+class LocalRpcServer {
+ public:
+  /// @param response_body body returned for every request
+  /// @param latency time the server waits before every response, to mimic
+  /// the round trip to a remote rpc node
+  explicit LocalRpcServer(
+      std::string response_body,
+      std::chrono::milliseconds latency = std::chrono::milliseconds(0))
+      : body(std::make_shared<const std::string>(std::move(response_body))),
+        latency(latency),
+        acceptor(ioc, {net::ip::make_address("127.0.0.1"), 0}) {
+    accept_thread = std::thread([this]() { accept_loop(); });
+  }
+
+  ~LocalRpcServer() {
+    stopped.store(true);
+    // unblock the pending accept with a last connection
+    boost::system::error_code ec;
+    tcp::socket socket(ioc);
+    socket.connect(acceptor.local_endpoint(), ec);
+    accept_thread.join();
+  }
+
+  /// @brief url to pass to a rpc::Connection
+  std::string url() const {
+    const auto port = acceptor.local_endpoint().port();
+    return "http://127.0.0.1:" + std::to_string(port);
+  }
+
+ private:
+  void accept_loop() {
+    while (!stopped.load()) {
+      boost::system::error_code ec;
+      tcp::socket socket(ioc);
+      acceptor.accept(socket, ec);
+      if (ec || stopped.load()) break;
+      // one thread per connection, it exits once the client hangs up
+      std::thread(&LocalRpcServer::serve, body, latency, std::move(socket))
+          .detach();
+    }
+  }
+
+  static void serve(std::shared_ptr<const std::string> body,
+                    std::chrono::milliseconds latency, tcp::socket socket) {
+    socket.set_option(tcp::no_delay(true));
+    beast::flat_buffer buffer;
+    boost::system::error_code ec;
+    for (;;) {
+      http::request<http::string_body> req;
+      http::read(socket, buffer, req, ec);
+      if (ec) break;
+      std::this_thread::sleep_for(latency);
+      http::response<http::string_body> res{http::status::ok, req.version()};
+      res.set(http::field::content_type, "application/json");
+      res.keep_alive(req.keep_alive());
+      res.body() = *body;
+      res.prepare_payload();
+      http::write(socket, res, ec);
+      if (ec || !res.keep_alive()) break;
+    }
+    socket.shutdown(tcp::socket::shutdown_send, ec);
+  }
+
+  std::shared_ptr<const std::string> body;
+  std::chrono::milliseconds latency;
+  net::io_context ioc;
+  tcp::acceptor acceptor;
+  std::thread accept_thread;
+  std::atomic_bool stopped{false};
+};
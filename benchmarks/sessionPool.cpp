@@ -0,0 +1,60 @@
+#include <cpr/cpr.h>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "localRpcServer.hpp"
+#include "solana.hpp"
+
+using json = nlohmann::json;
+
+// getBalance like response of a local rpc node
+const std::string RESPONSE =
+    R"({"jsonrpc":"2.0","result":{"context":{"slot":1},"value":42},"id":1})";
+const int REQUESTS_PER_THREAD = 2000;
+
+/// @brief run fn REQUESTS_PER_THREAD times on each of num_threads threads
+/// @return average latency in microseconds per request
+double measure(int num_threads, const std::function<void()> &fn) {
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&fn]() {
+      for (int i = 0; i < REQUESTS_PER_THREAD; ++i) fn();
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  const std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  // every thread sends its requests back to back
+  return elapsed.count() / REQUESTS_PER_THREAD;
+}
+
+int main() {
+  LocalRpcServer server(RESPONSE);
+  const auto url = server.url();
+  const json request = solana::rpc::jsonRequest(
+      "getBalance", {"11111111111111111111111111111111"});
+
+  // previous implementation: a new curl handle and connection per request
+  const auto perCall = [&]() {
+    const auto res =
+        cpr::Post(cpr::Url{url}, cpr::Body{request.dump()},
+                  cpr::Header{{"Content-Type", "application/json"}});
+    if (res.status_code != 200) throw std::runtime_error(res.error.message);
+    json::parse(res.text);
+  };
+
+  for (const int threads : {1, 4, 16}) {
+    const auto connection = solana::rpc::Connection(url, threads);
+    const auto pooled = [&]() { connection.sendJsonRpcRequest(request); };
+    spdlog::info("threads: {}", threads);
+    spdlog::info("  cpr::Post per call: {:.1f} us/request",
+                 measure(threads, perCall));
+    spdlog::info("  SessionPool:        {:.1f} us/request",
+                 measure(threads, pooled));
+  }
+}
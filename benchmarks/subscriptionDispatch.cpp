@@ -0,0 +1,138 @@
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "flatIdMap.hpp"
+
+const int NOTIFICATIONS = 2000000;
+
+using Callback = std::function<void(uint64_t)>;
+
+/// @brief the previous dispatch of session::call_callback: a shared lock, two
+/// map lookups and a copy of the callback
+struct LockedDispatch {
+  std::unordered_map<uint64_t, Callback> callback_map;
+  std::unordered_map<uint64_t, uint64_t> maps_wsid_to_id;
+  std::shared_mutex mutex_for_maps;
+
+  void subscribe(uint64_t ws_id, Callback cb) {
+    std::unique_lock lk(mutex_for_maps);
+    callback_map[ws_id] = std::move(cb);
+    maps_wsid_to_id[ws_id] = ws_id;
+  }
+
+  void publish() {}
+
+  void dispatch(uint64_t ws_id) {
+    Callback cb;
+    {
+      std::shared_lock lk(mutex_for_maps);
+      const auto id = maps_wsid_to_id.find(ws_id);
+      if (id == maps_wsid_to_id.end()) return;
+      const auto sub = callback_map.find(id->second);
+      if (sub == callback_map.end()) return;
+      cb = sub->second;
+    }
+    cb(ws_id);
+  }
+};
+
+/// @brief the dispatch of session::call_callback: an atomic load of an
+/// immutable table and one probe
+struct SnapshotDispatch {
+  std::unordered_map<uint64_t, Callback> callback_map;
+  std::shared_mutex mutex_for_maps;
+  std::atomic<const solana::FlatIdMap<const Callback *> *> table{nullptr};
+  // the session frees replaced tables on its strand, here they are kept
+  // until the benchmark ends
+  std::vector<std::unique_ptr<const solana::FlatIdMap<const Callback *>>>
+      retired;
+
+  void subscribe(uint64_t ws_id, Callback cb) {
+    std::unique_lock lk(mutex_for_maps);
+    callback_map[ws_id] = std::move(cb);
+  }
+
+  /// @brief rebuild the table after subscribing
+  void publish() {
+    std::unique_lock lk(mutex_for_maps);
+    std::vector<std::pair<uint64_t, const Callback *>> entries;
+    for (const auto &[id, callback] : callback_map) {
+      entries.emplace_back(id, &callback);
+    }
+    const auto next = new solana::FlatIdMap<const Callback *>(entries);
+    retired.emplace_back(table.exchange(next));
+  }
+
+  void dispatch(uint64_t ws_id) {
+    const auto callback = table.load(std::memory_order_acquire)->find(ws_id);
+    if (callback != nullptr) (**callback)(ws_id);
+  }
+
+  ~SnapshotDispatch() { delete table.load(); }
+};
+
+/// @brief dispatch NOTIFICATIONS to random subscriptions
+/// @return notifications per second
+template <typename Dispatch>
+double measure(Dispatch &dispatch, const std::vector<uint64_t> &ws_ids) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < NOTIFICATIONS; ++i) {
+    dispatch.dispatch(ws_ids[i % ws_ids.size()]);
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return NOTIFICATIONS / elapsed.count();
+}
+
+/// @brief notifications per second with subscriptions subscriptions, idle
+/// and while another thread subscribes every millisecond
+template <typename Dispatch>
+void compare(const std::string &name, size_t subscriptions) {
+  Dispatch dispatch;
+  uint64_t sink = 0;
+  const auto callback = [&sink](uint64_t ws_id) { sink += ws_id; };
+  for (uint64_t ws_id = 0; ws_id < subscriptions; ++ws_id) {
+    dispatch.subscribe(ws_id, callback);
+  }
+  dispatch.publish();
+  std::mt19937_64 rng(42);
+  std::vector<uint64_t> ws_ids(1 << 16);
+  for (auto &ws_id : ws_ids) ws_id = rng() % subscriptions;
+
+  const auto idle = measure(dispatch, ws_ids);
+
+  std::atomic<bool> done{false};
+  std::thread writer([&]() {
+    auto ws_id = subscriptions;
+    while (!done.load()) {
+      dispatch.subscribe(ws_id++, callback);
+      dispatch.publish();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  const auto contended = measure(dispatch, ws_ids);
+  done.store(true);
+  writer.join();
+
+  if (sink == 1) spdlog::debug("sink {}", sink);
+  spdlog::info("{} with {} subscriptions", name, subscriptions);
+  spdlog::info("  notifications/s:                  {:.2f}M", idle / 1e6);
+  spdlog::info("  notifications/s while subscribing: {:.2f}M",
+               contended / 1e6);
+}
+
+int main() {
+  for (const size_t subscriptions : {16, 1024, 16384}) {
+    compare<LockedDispatch>("shared_mutex + unordered_map", subscriptions);
+    compare<SnapshotDispatch>("snapshot flat map", subscriptions);
+  }
+}
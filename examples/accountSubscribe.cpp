@@ -1,72 +1,17 @@
 #include <spdlog/spdlog.h>
 
 #include <chrono>
-#include <nlohmann/json.hpp>
-#include <websocketpp/client.hpp>
-#include <websocketpp/config/asio_client.hpp>
+#include <climits>
+#include <thread>
 
 #include "int128.hpp"
 #include "mango_v3.hpp"
 
-typedef websocketpp::client<websocketpp::config::asio_tls_client> ws_client;
-typedef websocketpp::config::asio_client::message_type::ptr ws_message_ptr;
-typedef std::shared_ptr<boost::asio::ssl::context> context_ptr;
-
-using json = nlohmann::json;
-
-static context_ptr on_tls_init() {
-  // establishes a SSL connection
-  context_ptr ctx = std::make_shared<boost::asio::ssl::context>(
-      boost::asio::ssl::context::sslv23);
-
-  try {
-    ctx->set_options(boost::asio::ssl::context::default_workarounds |
-                     boost::asio::ssl::context::no_sslv2 |
-                     boost::asio::ssl::context::no_sslv3 |
-                     boost::asio::ssl::context::single_dh_use);
-  } catch (std::exception &e) {
-    spdlog::error("Error in context pointer: {}", e.what());
-  }
-  return ctx;
-}
-
-void on_open(ws_client *c, websocketpp::connection_hdl hdl) {
-  // subscribe to btc-perp eventQ
-  const std::string account = "7t5Me8RieYKsFpfLEV8jnpqcqswNpyWD95ZqgUXuLV8Z";
-  websocketpp::lib::error_code ec;
-
-  c->send(hdl,
-          solana::rpc::subscription::accountSubscribeRequest(account).dump(),
-          websocketpp::frame::opcode::value::text, ec);
-  if (ec) {
-    spdlog::error("subscribe failed because: {}", ec.message());
-  } else {
-    spdlog::info("subscribed to {}", account);
-  }
-}
-
 uint64_t lastSeqNum = INT_MAX;
 
-void on_message(ws_client *c, websocketpp::connection_hdl hdl,
-                ws_message_ptr msg) {
-  const json parsedMsg = json::parse(msg->get_payload());
-
-  // ignore subscription confirmation
-  const auto itResult = parsedMsg.find("result");
-  if (itResult != parsedMsg.end()) {
-    spdlog::info("on_result {}", parsedMsg.dump());
-    return;
-  }
-
-  // all other messages are event queue updates
-  const std::string method = parsedMsg["method"];
-  const int subscription = parsedMsg["params"]["subscription"];
-  const int slot = parsedMsg["params"]["result"]["context"]["slot"];
-  const std::string data = parsedMsg["params"]["result"]["value"]["data"][0];
-
-  const auto decoded = solana::b64decode(data);
-  const auto events =
-      reinterpret_cast<const mango_v3::EventQueue *>(decoded.data());
+void on_event_queue(const solana::AccountInfo<mango_v3::EventQueue> &info,
+                    uint64_t /*slot*/) {
+  const auto events = &info.data;
   const auto seqNumDiff = events->header.seqNum - lastSeqNum;
   const auto lastSlot =
       (events->header.head + events->header.count) % mango_v3::EVENT_QUEUE_SIZE;
@@ -124,40 +69,18 @@ void on_message(ws_client *c, websocketpp::connection_hdl hdl,
 }
 
 int main() {
-  try {
-    ws_client c;
-
-    c.set_access_channels(websocketpp::log::alevel::all);
-
-    // Initialize ASIO
-    c.init_asio();
-    c.set_tls_init_handler(websocketpp::lib::bind(&on_tls_init));
-
-    // Register message handlers
-    c.set_open_handler(websocketpp::lib::bind(
-        &on_open, &c, websocketpp::lib::placeholders::_1));
-    c.set_message_handler(websocketpp::lib::bind(
-        &on_message, &c, websocketpp::lib::placeholders::_1,
-        websocketpp::lib::placeholders::_2));
-
-    websocketpp::lib::error_code ec;
-    ws_client::connection_ptr con = c.get_connection(
-        "wss://mango.rpcpool.com/946ef7337da3f5b8d3e4a34e7f88", ec);
-    if (ec) {
-      spdlog::error("could not create connection because: {}", ec.message());
-      return 0;
-    }
-
-    // Note that connect here only requests a connection. No network messages
-    // are exchanged until the event loop starts running in the next line.
-    c.connect(con);
-
-    // Start the ASIO io_service run loop
-    // this will cause a single connection to be made to the server. c.run()
-    // will exit when this connection is closed.
-    c.run();
-  } catch (websocketpp::exception const &e) {
-    std::cout << e.what() << std::endl;
+  // subscribe to btc-perp eventQ
+  const std::string account = "7t5Me8RieYKsFpfLEV8jnpqcqswNpyWD95ZqgUXuLV8Z";
+  solana::rpc::subscription::WebSocketSubscriber sub(
+      "wss://mango.rpcpool.com/946ef7337da3f5b8d3e4a34e7f88");
+  sub.onAccountChange<mango_v3::EventQueue>(
+      solana::PublicKey::fromBase58(account), on_event_queue,
+      solana::Commitment::PROCESSED,
+      [&](const json &) { spdlog::info("subscribed to {}", account); });
+
+  // notifications are handled on the subscriber's thread
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
   }
 
   return 0;
@@ -9,47 +9,58 @@ int main() {
   const auto& config = mango_v3::MAINNET;
   auto connection = solana::rpc::Connection(config.endpoint);
   const auto accountPubkey = "F3TTrgxjrkAHdS9zEidtwU5VXyvMgr5poii4HYatZheH";
-  const auto& mangoAccountInfo =
-      connection
-          .getAccountInfo<mango_v3::MangoAccountInfo>(
-              solana::PublicKey::fromBase58(accountPubkey))
-          .value.value()
-          .data;
+  // the account and its group don't depend on each other, fetch them together
+  auto batch = solana::rpc::BatchRequest(connection);
+  auto accountRes = batch.getAccountInfo<mango_v3::MangoAccountInfo>(
+      solana::PublicKey::fromBase58(accountPubkey));
+  auto groupRes = batch.getAccountInfo<mango_v3::MangoGroup>(
+      solana::PublicKey::fromBase58(config.group));
+  batch.send();
+  const auto mangoAccountInfo = accountRes.get().value.value().data;
+  const auto group = groupRes.get().value.value().data;
   mango_v3::MangoAccount mangoAccount =
       mango_v3::MangoAccount(mangoAccountInfo);
-  auto openOrders = mangoAccount.loadOpenOrders(connection);
-  auto group = connection
-                   .getAccountInfo<mango_v3::MangoGroup>(
-                       solana::PublicKey::fromBase58(config.group))
-                   .value.value()
-                   .data;
-  auto cache = connection.getAccountInfo<mango_v3::MangoCache>(group.mangoCache)
-                   .value.value()
-                   .data;
-  auto maintHealth =
-      mangoAccount.getHealth(group, cache, mango_v3::HealthType::Maint);
-  auto initHealth =
-      mangoAccount.getHealth(group, cache, mango_v3::HealthType::Init);
-  auto maintHealthRatio =
-      mangoAccount.getHealthRatio(group, cache, mango_v3::HealthType::Maint);
+  // open orders & cache are referenced by the account & group, second batch
+  std::vector<solana::PublicKey> openOrdersKeys;
+  std::vector<size_t> openOrdersMarkets;
+  for (size_t i = 0; i < mango_v3::MAX_PAIRS; i++) {
+    const auto& key = mangoAccountInfo.spotOpenOrders[i];
+    if (key == solana::PublicKey::empty()) continue;
+    openOrdersKeys.emplace_back(key);
+    openOrdersMarkets.emplace_back(i);
+  }
+  auto openOrdersRes =
+      batch.getMultipleAccountsInfo<serum_v3::OpenOrders>(openOrdersKeys);
+  auto cacheRes = batch.getAccountInfo<mango_v3::MangoCache>(group.mangoCache);
+  batch.send();
+  const auto openOrdersInfos = openOrdersRes.get().value;
+  for (size_t i = 0; i < openOrdersInfos.size(); i++) {
+    mangoAccount.spotOpenOrdersAccounts[openOrdersMarkets[i]] =
+        openOrdersInfos[i].value().data;
+  }
+  const auto cache = cacheRes.get().value.value().data;
+  const auto health = mangoAccount.getHealthSummary(group, cache);
   spdlog::info("MangoAccount: {}", accountPubkey);
   spdlog::info("Owner: {}", mangoAccountInfo.owner.toBase58());
-  spdlog::info("Maint Health Ratio: {:.4f}", maintHealthRatio.to_double());
-  spdlog::info("Maint Health: {:.4f}", maintHealth.to_double());
-  spdlog::info("Init Health: {:.4f}", initHealth.to_double());
+  spdlog::info("Maint Health Ratio: {:.4f}",
+               health.maintHealthRatio.to_double());
+  spdlog::info("Maint Health: {:.4f}", health.maintHealth.to_double());
+  spdlog::info("Init Health: {:.4f}", health.initHealth.to_double());
   spdlog::info("Equity: {:.4f}",
                mangoAccount.computeValue(group, cache).to_double());
   spdlog::info("isBankrupt: {}", mangoAccount.mangoAccountInfo.isBankrupt);
   spdlog::info("beingLiquidated: {}",
                mangoAccount.mangoAccountInfo.beingLiquidated);
-  spdlog::info("---OpenOrders:{}---", openOrders.size());
-  for (auto& openOrder : openOrders) {
-    spdlog::info("Address: {}", openOrder.first);
-    spdlog::info("Owner: {}", openOrder.second.owner.toBase58());
-    spdlog::info("Market: {}", openOrder.second.market.toBase58());
-    spdlog::info("baseTokenFree: {}", openOrder.second.baseTokenFree);
-    spdlog::info("baseTokenTotal: {}", openOrder.second.baseTokenTotal);
-    spdlog::info("quoteTokenFree: {}", openOrder.second.quoteTokenFree);
-    spdlog::info("quoteTokenTotal: {}", openOrder.second.quoteTokenTotal);
+  spdlog::info("---OpenOrders:{}---", openOrdersKeys.size());
+  for (size_t i = 0; i < mango_v3::MAX_PAIRS; i++) {
+    const auto openOrder = mangoAccount.getOpenOrders(i);
+    if (!openOrder) continue;
+    spdlog::info("Address: {}", mangoAccountInfo.spotOpenOrders[i].toBase58());
+    spdlog::info("Owner: {}", openOrder->owner.toBase58());
+    spdlog::info("Market: {}", openOrder->market.toBase58());
+    spdlog::info("baseTokenFree: {}", openOrder->baseTokenFree);
+    spdlog::info("baseTokenTotal: {}", openOrder->baseTokenTotal);
+    spdlog::info("quoteTokenFree: {}", openOrder->quoteTokenFree);
+    spdlog::info("quoteTokenTotal: {}", openOrder->quoteTokenTotal);
   }
 }
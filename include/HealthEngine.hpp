@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "MangoAccount.hpp"
+
+namespace mango_v3 {
+///
+/// Health of many accounts of one MangoGroup
+///
+/// Weights are gathered once per group, and prices, root bank and perp market
+/// cache entries once per cache update, into per market arrays. The OpenOrders
+/// of every account are resolved once per batch into a flat table of
+/// pointers. Accounts are then evaluated against these arrays without maps or
+/// allocations, optionally spread over several threads, and the results are
+/// stored as one array per health type. Results are bit identical to
+/// MangoAccount::getHealth.
+class HealthEngine {
+ public:
+  using OpenOrdersMap =
+      std::unordered_map<solana::PublicKey, serum_v3::OpenOrders>;
+
+  struct Results {
+    std::vector<i80f48> initHealth;
+    std::vector<i80f48> maintHealth;
+    // OpenOrders per account and market, MAX_PAIRS per account, nullptr if
+    // not in the margin basket or not loaded. Points into the OpenOrdersMap
+    std::vector<const serum_v3::OpenOrders*> openOrders;
+  };
+
+  explicit HealthEngine(const MangoGroup& mangoGroup)
+      : mangoGroup_(mangoGroup),
+        init_(getWeightTable<HealthType::Init>(mangoGroup)),
+        maint_(getWeightTable<HealthType::Maint>(mangoGroup)) {}
+
+  /**
+   * Compute init and maint health of accounts[0, count) into results, which
+   * is resized to count and can be reused across cache updates
+   * @param openOrders OpenOrders of all accounts by address
+   * @param threads number of threads to spread the accounts over, 0 for one
+   * per core
+   */
+  void compute(const MangoCache& mangoCache, const MangoAccountInfo* accounts,
+               size_t count, const OpenOrdersMap& openOrders, Results& results,
+               unsigned threads = 1) const {
+    results.initHealth.resize(count);
+    results.maintHealth.resize(count);
+    results.openOrders.resize(count * MAX_PAIRS);
+    const auto markets = getMarketTable(mangoCache);
+
+    parallelFor(count, threads, [&](size_t a) {
+      resolveOpenOrders(accounts[a], openOrders,
+                        &results.openOrders[a * MAX_PAIRS]);
+    });
+    parallelFor(count, threads, [&](size_t a) {
+      evaluateAccount(markets, accounts[a], &results.openOrders[a * MAX_PAIRS],
+                      results.initHealth[a], results.maintHealth[a]);
+    });
+  }
+
+  Results compute(const MangoCache& mangoCache,
+                  const std::vector<MangoAccountInfo>& accounts,
+                  const OpenOrdersMap& openOrders, unsigned threads = 1) const {
+    Results results;
+    compute(mangoCache, accounts.data(), accounts.size(), openOrders, results,
+            threads);
+    return results;
+  }
+
+  /**
+   * Price sensitivity of accounts[0, count) for healthType into results, see
+   * compute for the parameters
+   */
+  void computeSensitivity(const MangoCache& mangoCache,
+                          const MangoAccountInfo* accounts, size_t count,
+                          const OpenOrdersMap& openOrders,
+                          HealthType healthType,
+                          std::vector<PriceSensitivity>& results,
+                          unsigned threads = 1) const {
+    results.resize(count);
+    parallelFor(count, threads, [&](size_t a) {
+      results[a] = MangoAccount::getPriceSensitivity(
+          accounts[a], mangoGroup_, mangoCache, healthType,
+          FindOpenOrders{accounts[a], openOrders});
+    });
+  }
+
+  /**
+   * Health of all accounts after each of a series of shocks to the price of
+   * one market, one row of sensitivities.size() values per shock
+   * @param factors price multipliers, 0.9 for a 10% drop
+   */
+  static std::vector<i80f48> healthUnderShocks(
+      const std::vector<PriceSensitivity>& sensitivities, uint64_t market,
+      const std::vector<double>& factors) {
+    std::vector<i80f48> health;
+    health.reserve(factors.size() * sensitivities.size());
+    for (const auto factor : factors) {
+      const auto change = i80f48(factor - 1);
+      for (const auto& sensitivity : sensitivities) {
+        health.push_back(sensitivity.health +
+                         sensitivity.slopes[market] *
+                             (sensitivity.prices[market] * change));
+      }
+    }
+    return health;
+  }
+
+ private:
+  // cache and group entries of all markets, one array per field
+  struct MarketTable {
+    RootBankCache quoteBank;
+    std::array<i80f48, MAX_PAIRS> prices;
+    std::array<RootBankCache, MAX_PAIRS> banks;
+    std::array<PerpMarketCache, MAX_PAIRS> perpCaches;
+    std::array<const PerpMarketInfo*, MAX_PAIRS> perpMarkets;
+  };
+
+  MarketTable getMarketTable(const MangoCache& mangoCache) const {
+    MarketTable markets;
+    markets.quoteBank = mangoCache.root_bank_cache[QUOTE_INDEX];
+    for (uint64_t i = 0; i < mangoGroup_.numOracles; i++) {
+      const auto& perpMarket = mangoGroup_.perpMarkets[i];
+      markets.prices[i] = mangoCache.price_cache[i].price;
+      markets.banks[i] = mangoCache.root_bank_cache[i];
+      markets.perpCaches[i] = mangoCache.perp_market_cache[i];
+      markets.perpMarkets[i] =
+          perpMarket.perpMarket == solana::PublicKey::empty() ? nullptr
+                                                              : &perpMarket;
+    }
+    return markets;
+  }
+
+  void resolveOpenOrders(const MangoAccountInfo& account,
+                         const OpenOrdersMap& openOrders,
+                         const serum_v3::OpenOrders** resolved) const {
+    const FindOpenOrders find{account, openOrders};
+    for (uint64_t i = 0; i < mangoGroup_.numOracles; i++) {
+      resolved[i] = account.inMarginBasket[i] ? find(i) : nullptr;
+    }
+  }
+
+  void evaluateAccount(const MarketTable& markets,
+                       const MangoAccountInfo& account,
+                       const serum_v3::OpenOrders* const* openOrders,
+                       i80f48& initHealth, i80f48& maintHealth) const {
+    // i80f48 sums are exact, so the order of the terms doesn't matter
+    const auto quote =
+        MangoAccount::getNet(account.deposits[QUOTE_INDEX],
+                             account.borrows[QUOTE_INDEX], markets.quoteBank);
+    initHealth = quote;
+    maintHealth = quote;
+    for (uint64_t i = 0; i < mangoGroup_.numOracles; i++) {
+      const auto price = markets.prices[i];
+      const auto market = MangoAccount::getMarketHealthComponents(
+          account.deposits[i], account.borrows[i], openOrders[i],
+          account.perpAccounts[i], price, markets.banks[i],
+          markets.perpMarkets[i], markets.perpCaches[i]);
+      initHealth += market.quote;
+      maintHealth += market.quote;
+      initHealth += MangoAccount::healthContribution(
+          market.spot, price, init_.spotAsset[i], init_.spotLiab[i]);
+      initHealth += MangoAccount::healthContribution(
+          market.perp, price, init_.perpAsset[i], init_.perpLiab[i]);
+      maintHealth += MangoAccount::healthContribution(
+          market.spot, price, maint_.spotAsset[i], maint_.spotLiab[i]);
+      maintHealth += MangoAccount::healthContribution(
+          market.perp, price, maint_.perpAsset[i], maint_.perpLiab[i]);
+    }
+  }
+
+  // OpenOrders of account by market index, see
+  // MangoAccount::getHealthComponents
+  struct FindOpenOrders {
+    const MangoAccountInfo& account;
+    const OpenOrdersMap& openOrders;
+    const serum_v3::OpenOrders* operator()(uint64_t market) const {
+      const auto it = openOrders.find(account.spotOpenOrders[market]);
+      return it == openOrders.end() ? nullptr : &it->second;
+    }
+  };
+
+  /**
+   * Call f(i) for i in [0, count), spread over threads in contiguous chunks.
+   * Exceptions of workers are rethrown after all of them finished
+   */
+  template <typename F>
+  static void parallelFor(size_t count, unsigned threads, const F& f) {
+    const auto run = [&f](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) f(i);
+    };
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    threads = static_cast<unsigned>(
+        std::min<size_t>(std::max(threads, 1u), std::max<size_t>(count, 1)));
+    if (threads == 1) {
+      run(0, count);
+      return;
+    }
+
+    // contiguous chunks, every thread writes its own range of results
+    const auto chunk = (count + threads - 1) / threads;
+    std::vector<std::exception_ptr> errors(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++) {
+      workers.emplace_back([&, t]() {
+        try {
+          run(std::min(count, t * chunk), std::min(count, (t + 1) * chunk));
+        } catch (...) {
+          errors[t] = std::current_exception();
+        }
+      });
+    }
+    try {
+      run(0, std::min(count, chunk));
+    } catch (...) {
+      errors[0] = std::current_exception();
+    }
+    for (auto& worker : workers) worker.join();
+    for (const auto& error : errors) {
+      if (error) std::rethrow_exception(error);
+    }
+  }
+
+  MangoGroup mangoGroup_;
+  WeightTable init_;
+  WeightTable maint_;
+};
+}  // namespace mango_v3
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <stdexcept>
+
+#include "MangoAccount.hpp"
+
+namespace mango_v3 {
+///
+/// Init and maint health of one account, kept up to date across MangoCache
+/// updates
+///
+/// Per market base positions, quote contributions and weighted health
+/// contributions are stored together with the cache entries they were
+/// computed from. On update only markets whose price, root bank indices or
+/// funding changed are recomputed and their difference applied to the totals,
+/// so an oracle tick costs O(changed markets). Results are bit identical to
+/// MangoAccount::getHealth since i80f48 sums are exact.
+///
+/// Only the account state health depends on is kept: deposits, borrows, perp
+/// positions and the token totals of each open orders account, a few KB
+/// instead of a MangoAccount with its loaded OpenOrders.
+///
+/// Weights come from the GroupWeights of the group, like in HealthEngine. The
+/// MangoGroup and GroupWeights are referenced, not copied, so many trackers
+/// share them, and have to outlive the tracker. Construct a new tracker when
+/// the account or its open orders change.
+class HealthTracker {
+ public:
+  HealthTracker(const MangoGroup& mangoGroup, const GroupWeights& groupWeights,
+                const MangoAccount& mangoAccount, const MangoCache& mangoCache)
+      : mangoGroup_(mangoGroup),
+        init_(groupWeights.get<HealthType::Init>()),
+        maint_(groupWeights.get<HealthType::Maint>()) {
+    const auto& accountInfo = mangoAccount.mangoAccountInfo;
+    beingLiquidated_ = accountInfo.beingLiquidated;
+    quoteDeposit_ = accountInfo.deposits[QUOTE_INDEX];
+    quoteBorrow_ = accountInfo.borrows[QUOTE_INDEX];
+    const auto& quoteBank = mangoCache.root_bank_cache[QUOTE_INDEX];
+    quoteBank_ = {quoteBank.deposit_index, quoteBank.borrow_index};
+    quoteNet_ = MangoAccount::getNet(quoteDeposit_, quoteBorrow_, quoteBank);
+    for (uint64_t i = 0; i < mangoGroup_.numOracles; i++) {
+      auto& account = markets_[i].account;
+      account.deposit = accountInfo.deposits[i];
+      account.borrow = accountInfo.borrows[i];
+      account.perpAccount = accountInfo.perpAccounts[i];
+      const auto openOrders = mangoAccount.getOpenOrders(i);
+      if (accountInfo.inMarginBasket[i] && openOrders) {
+        account.hasOpenOrders = true;
+        account.openOrders = {openOrders->baseTokenFree,
+                              openOrders->baseTokenTotal,
+                              openOrders->quoteTokenFree,
+                              openOrders->quoteTokenTotal,
+                              openOrders->referrerRebatesAccrued};
+      }
+      markets_[i].inputs = inputs(mangoCache, i);
+      evaluate(mangoCache, i, markets_[i]);
+      quoteSum_ += markets_[i].quote;
+      initSum_ += markets_[i].init;
+      maintSum_ += markets_[i].maint;
+    }
+  }
+
+  /**
+   * Recompute the markets whose cache entries changed
+   * @return number of markets recomputed, plus one if the quote root bank
+   * changed. 0 if health is unchanged
+   */
+  size_t update(const MangoCache& mangoCache) {
+    size_t changed = 0;
+    const auto& quoteBank = mangoCache.root_bank_cache[QUOTE_INDEX];
+    const BankIndices quoteIndices = {quoteBank.deposit_index,
+                                      quoteBank.borrow_index};
+    if (!(quoteIndices == quoteBank_)) {
+      quoteBank_ = quoteIndices;
+      quoteNet_ = MangoAccount::getNet(quoteDeposit_, quoteBorrow_, quoteBank);
+      changed++;
+    }
+    for (uint64_t i = 0; i < mangoGroup_.numOracles; i++) {
+      auto& market = markets_[i];
+      const auto next = inputs(mangoCache, i);
+      if (next == market.inputs) continue;
+      quoteSum_ -= market.quote;
+      initSum_ -= market.init;
+      maintSum_ -= market.maint;
+      market.inputs = next;
+      evaluate(mangoCache, i, market);
+      quoteSum_ += market.quote;
+      initSum_ += market.init;
+      maintSum_ += market.maint;
+      changed++;
+    }
+    return changed;
+  }
+
+  i80f48 getHealth(HealthType healthType) const {
+    switch (healthType) {
+      case HealthType::Init:
+        return quoteNet_ + quoteSum_ + initSum_;
+      case HealthType::Maint:
+        return quoteNet_ + quoteSum_ + maintSum_;
+      default:
+        throw std::runtime_error("HealthTracker tracks Init and Maint only");
+    }
+  }
+
+  bool isLiquidatable() const {
+    return (beingLiquidated_ && getHealth(HealthType::Init) < 0) ||
+           getHealth(HealthType::Maint) < 0;
+  }
+
+  bool isBeingLiquidated() const { return beingLiquidated_; }
+
+ private:
+  struct BankIndices {
+    i80f48 deposit;
+    i80f48 borrow;
+    bool operator==(const BankIndices& other) const {
+      return deposit == other.deposit && borrow == other.borrow;
+    }
+  };
+
+  // the cache entries a market's health components depend on
+  struct MarketInputs {
+    i80f48 price;
+    BankIndices bank;
+    i80f48 longFunding;
+    i80f48 shortFunding;
+    bool operator==(const MarketInputs& other) const {
+      return price == other.price && bank == other.bank &&
+             longFunding == other.longFunding &&
+             shortFunding == other.shortFunding;
+    }
+  };
+
+  // the OpenOrders fields health reads, without the order slots
+  struct OpenOrdersBalances {
+    uint64_t baseTokenFree;
+    uint64_t baseTokenTotal;
+    uint64_t quoteTokenFree;
+    uint64_t quoteTokenTotal;
+    uint64_t referrerRebatesAccrued;
+  };
+
+  // the account state a market's health components depend on
+  struct MarketAccount {
+    i80f48 deposit;
+    i80f48 borrow;
+    PerpAccountInfo perpAccount;
+    bool hasOpenOrders;
+    OpenOrdersBalances openOrders;
+  };
+
+  struct MarketState {
+    MarketAccount account;
+    MarketInputs inputs;
+    i80f48 quote;
+    i80f48 init;
+    i80f48 maint;
+  };
+
+  static MarketInputs inputs(const MangoCache& mangoCache, uint64_t i) {
+    const auto& bank = mangoCache.root_bank_cache[i];
+    const auto& perp = mangoCache.perp_market_cache[i];
+    return {mangoCache.price_cache[i].price,
+            {bank.deposit_index, bank.borrow_index},
+            perp.long_funding,
+            perp.short_funding};
+  }
+
+  void evaluate(const MangoCache& mangoCache, uint64_t i,
+                MarketState& market) const {
+    const auto& account = market.account;
+    const auto components = MangoAccount::getMarketHealthComponents(
+        account.deposit, account.borrow,
+        account.hasOpenOrders ? &account.openOrders : nullptr,
+        account.perpAccount, mangoGroup_, mangoCache, i);
+    const auto price = market.inputs.price;
+    const auto spot = components.spot;
+    const auto perp = components.perp;
+    market.quote = components.quote;
+    market.init =
+        MangoAccount::healthContribution(spot, price, init_.spotAsset[i],
+                                         init_.spotLiab[i]) +
+        MangoAccount::healthContribution(perp, price, init_.perpAsset[i],
+                                         init_.perpLiab[i]);
+    market.maint =
+        MangoAccount::healthContribution(spot, price, maint_.spotAsset[i],
+                                         maint_.spotLiab[i]) +
+        MangoAccount::healthContribution(perp, price, maint_.perpAsset[i],
+                                         maint_.perpLiab[i]);
+  }
+
+  const MangoGroup& mangoGroup_;
+  const WeightTable& init_;
+  const WeightTable& maint_;
+  bool beingLiquidated_;
+  i80f48 quoteDeposit_;
+  i80f48 quoteBorrow_;
+  BankIndices quoteBank_;
+  i80f48 quoteNet_ = 0L;
+  i80f48 quoteSum_ = 0L;
+  i80f48 initSum_ = 0L;
+  i80f48 maintSum_ = 0L;
+  std::array<MarketState, MAX_PAIRS> markets_{};
+};
+}  // namespace mango_v3
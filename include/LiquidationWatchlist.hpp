@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "HealthTracker.hpp"
+
+namespace mango_v3 {
+///
+/// Accounts of one MangoGroup ordered by how close they are to liquidation
+///
+/// Accounts are ranked by their liquidation health: maint health, or the
+/// lower of init and maint health for accounts already being liquidated. An
+/// account is liquidatable exactly when its liquidation health is negative, see
+/// MangoAccount::isLiquidatable. Every account is kept in a HealthTracker, so
+/// a cache update only recomputes changed markets and only accounts whose
+/// health moved are re-ranked. topK walks the ordered index and costs O(k).
+///
+/// An entry holds the tracker's per-market balances, not the account and its
+/// OpenOrders, so it stays at a few KB per account and upsert doesn't retain
+/// the MangoAccount passed in. The weights of the group are gathered once
+/// into a GroupWeights all trackers share.
+///
+/// The MangoGroup is referenced, not copied, and has to outlive the
+/// watchlist.
+class LiquidationWatchlist {
+ public:
+  struct Candidate {
+    solana::PublicKey address;
+    i80f48 liquidationHealth;
+    bool isLiquidatable;
+  };
+
+  LiquidationWatchlist(const MangoGroup& mangoGroup,
+                       const MangoCache& mangoCache)
+      : mangoGroup_(mangoGroup),
+        groupWeights_(mangoGroup),
+        mangoCache_(mangoCache) {}
+
+  // trackers reference groupWeights_
+  LiquidationWatchlist(const LiquidationWatchlist&) = delete;
+  LiquidationWatchlist& operator=(const LiquidationWatchlist&) = delete;
+
+  /**
+   * Add an account or replace it after an account or open orders update
+   */
+  void upsert(const solana::PublicKey& address,
+              const MangoAccount& mangoAccount) {
+    erase(address);
+    Entry entry{
+        HealthTracker(mangoGroup_, groupWeights_, mangoAccount, mangoCache_),
+        {}};
+    entry.rank = ranking_.emplace(liquidationHealth(entry.tracker), address);
+    entries_.emplace(address, std::move(entry));
+  }
+
+  /**
+   * @return false if the account wasn't watched
+   */
+  bool erase(const solana::PublicKey& address) {
+    const auto it = entries_.find(address);
+    if (it == entries_.end()) return false;
+    ranking_.erase(it->second.rank);
+    entries_.erase(it);
+    return true;
+  }
+
+  /**
+   * Apply a MangoCache update to all accounts
+   * @return number of accounts whose rank was updated
+   */
+  size_t update(const MangoCache& mangoCache) {
+    mangoCache_ = mangoCache;
+    size_t reranked = 0;
+    for (auto& [address, entry] : entries_) {
+      // 0 if no market and not the quote bank changed
+      if (entry.tracker.update(mangoCache) == 0) continue;
+      const auto health = liquidationHealth(entry.tracker);
+      if (health == entry.rank->first) continue;
+      // reuse the node, no allocation per re-rank
+      auto node = ranking_.extract(entry.rank);
+      node.key() = health;
+      entry.rank = ranking_.insert(std::move(node));
+      reranked++;
+    }
+    return reranked;
+  }
+
+  /**
+   * The k accounts with the lowest liquidation health, lowest first
+   */
+  std::vector<Candidate> topK(size_t k) const {
+    std::vector<Candidate> result;
+    result.reserve(std::min(k, ranking_.size()));
+    for (auto it = ranking_.begin(); it != ranking_.end() && k > 0; ++it, --k) {
+      result.push_back({it->second, it->first, it->first < 0});
+    }
+    return result;
+  }
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  using Ranking = std::multimap<i80f48, solana::PublicKey>;
+
+  struct Entry {
+    HealthTracker tracker;
+    Ranking::iterator rank;
+  };
+
+  static i80f48 liquidationHealth(const HealthTracker& tracker) {
+    const auto maintHealth = tracker.getHealth(HealthType::Maint);
+    if (!tracker.isBeingLiquidated()) {
+      return maintHealth;
+    }
+    return std::min(tracker.getHealth(HealthType::Init), maintHealth);
+  }
+
+  const MangoGroup& mangoGroup_;
+  const GroupWeights groupWeights_;
+  MangoCache mangoCache_;
+  std::unordered_map<solana::PublicKey, Entry> entries_;
+  Ranking ranking_;
+};
+}  // namespace mango_v3
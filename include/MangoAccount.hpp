@@ -1,14 +1,93 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <future>
+#include <optional>
+
 #include "mango_v3.hpp"
 #include "solana.hpp"
 #include "utils.hpp"
 
 namespace mango_v3 {
+/**
+ * Spot and perp base positions per market and the quote position, after
+ * adjusting for worst case open orders. Not adjusted for health type
+ */
+struct HealthComponents {
+  std::array<i80f48, MAX_PAIRS> spot{};
+  std::array<i80f48, MAX_PAIRS> perps{};
+  i80f48 quote = 0L;
+};
+
+/**
+ * Spot and perp base positions of one market and their contribution to the
+ * quote position
+ */
+struct MarketHealthComponents {
+  i80f48 spot = 0L;
+  i80f48 perp = 0L;
+  i80f48 quote = 0L;
+  // d(spot * price) / d price, differs from spot if bids are outstanding
+  i80f48 spotPriceSlope = 0L;
+  // d quote / d price, from open orders and perp quote positions
+  i80f48 quotePriceSlope = 0L;
+};
+
+/**
+ * Health of an account as a linear function of each market price, with the
+ * positions at the prices it was computed at held fixed. Exact as long as no
+ * position changes sign and the worse case of open orders doesn't flip
+ */
+struct PriceSensitivity {
+  uint64_t numMarkets = 0;
+  // health at prices
+  i80f48 health = 0L;
+  std::array<i80f48, MAX_PAIRS> prices{};
+  // d health / d price per market
+  std::array<i80f48, MAX_PAIRS> slopes{};
+
+  /**
+   * health if the price of market changed to price, all others unchanged
+   */
+  i80f48 healthAt(uint64_t market, i80f48 price) const {
+    return health + slopes[market] * (price - prices[market]);
+  }
+  /**
+   * health at a set of prices of all markets
+   */
+  i80f48 healthAt(const std::array<i80f48, MAX_PAIRS>& newPrices) const {
+    auto result = health;
+    for (uint64_t i = 0; i < numMarkets; i++) {
+      result += slopes[i] * (newPrices[i] - prices[i]);
+    }
+    return result;
+  }
+  /**
+   * price of market at which health crosses zero, all other prices unchanged
+   * @return std::nullopt if health doesn't depend on the price or the price
+   * would have to be negative
+   */
+  std::optional<i80f48> liquidationPrice(uint64_t market) const {
+    if (slopes[market] == 0) return std::nullopt;
+    const auto price = prices[market] - health / slopes[market];
+    if (price <= 0) return std::nullopt;
+    return price;
+  }
+};
+
+struct HealthSummary {
+  i80f48 initHealth;
+  i80f48 maintHealth;
+  i80f48 initHealthRatio;
+  i80f48 maintHealthRatio;
+};
+
 struct MangoAccount {
   MangoAccountInfo mangoAccountInfo;
-  // {address, OpenOrders}
-  std::unordered_map<std::string, serum_v3::OpenOrders> spotOpenOrdersAccounts;
+  // OpenOrders of mangoAccountInfo.spotOpenOrders, by market index
+  std::array<std::optional<serum_v3::OpenOrders>, MAX_PAIRS>
+      spotOpenOrdersAccounts;
   explicit MangoAccount(const MangoAccountInfo& accountInfo_) noexcept {
     mangoAccountInfo = accountInfo_;
     // TODO: Call `loadOpenOrders()`
@@ -19,37 +98,79 @@ struct MangoAccount {
         connection.getAccountInfo<MangoAccountInfo>(pubKey).value.value().data;
     mangoAccountInfo = accountInfo_;
   }
-  // Returns map(Address: OpenOrders) and sets this accounts
-  // `spotOpenOrdersAccounts`
-  auto loadOpenOrders(solana::rpc::Connection& connection) {
+  // Loads and returns this accounts `spotOpenOrdersAccounts`
+  const auto& loadOpenOrders(solana::rpc::Connection& connection) {
+    loadOpenOrders(connection, this, 1);
+    return spotOpenOrdersAccounts;
+  }
+  /**
+   * Load the OpenOrders of many accounts at once. Keys are fetched with
+   * getMultipleAccounts requests of at most MAX_MULTIPLE_ACCOUNTS keys, all
+   * in flight at the same time
+   */
+  static void loadOpenOrders(solana::rpc::Connection& connection,
+                             MangoAccount* accounts, size_t count) {
     // Filter only non-empty open orders
-    std::vector<solana::PublicKey> filteredOpenOrders;
-    for (auto item : mangoAccountInfo.spotOpenOrders) {
-      if (item == solana::PublicKey::empty()) continue;
-      filteredOpenOrders.emplace_back(item);
+    std::vector<solana::PublicKey> keys;
+    std::vector<std::pair<MangoAccount*, size_t>> targets;
+    for (size_t a = 0; a < count; a++) {
+      auto& account = accounts[a];
+      account.spotOpenOrdersAccounts = {};
+      for (size_t i = 0; i < MAX_PAIRS; i++) {
+        const auto& key = account.mangoAccountInfo.spotOpenOrders[i];
+        if (key == solana::PublicKey::empty()) continue;
+        keys.emplace_back(key);
+        targets.emplace_back(&account, i);
+      }
     }
-    const auto accountsInfo =
-        connection
-            .getMultipleAccountsInfo<serum_v3::OpenOrders>(filteredOpenOrders)
-            .value;
-    // clear spotOpenOrdersAccounts
-    spotOpenOrdersAccounts.clear();
-    // take out data from accountInfo
-    std::vector<serum_v3::OpenOrders> accountsInfoData;
-    auto index = 0;
-    for (const auto& accountInfo : accountsInfo) {
-      spotOpenOrdersAccounts[filteredOpenOrders[index].toBase58()] =
-          accountInfo.value().data;
+    using Chunk = std::future<solana::RpcResponseAndContext<
+        std::vector<std::optional<solana::AccountInfo<serum_v3::OpenOrders>>>>>;
+    std::vector<Chunk> chunks;
+    for (size_t begin = 0; begin < keys.size();
+         begin += solana::rpc::MAX_MULTIPLE_ACCOUNTS) {
+      const auto end =
+          std::min(keys.size(), begin + solana::rpc::MAX_MULTIPLE_ACCOUNTS);
+      chunks.push_back(
+          connection.getMultipleAccountsInfoAsync<serum_v3::OpenOrders>(
+              {keys.begin() + begin, keys.begin() + end}));
     }
-    return spotOpenOrdersAccounts;
+    // responses keep the order of the keys
+    auto target = targets.begin();
+    for (auto& chunk : chunks) {
+      for (const auto& accountInfo : chunk.get().value) {
+        const auto [account, market] = *target++;
+        if (accountInfo) {
+          account->spotOpenOrdersAccounts[market] = accountInfo->data;
+        }
+      }
+    }
+  }
+  static void loadOpenOrders(solana::rpc::Connection& connection,
+                             std::vector<MangoAccount>& accounts) {
+    loadOpenOrders(connection, accounts.data(), accounts.size());
+  }
+  /**
+   * @return OpenOrders of a spot market, nullptr if not loaded
+   */
+  const serum_v3::OpenOrders* getOpenOrders(uint64_t marketIndex) const {
+    const auto& openOrders = spotOpenOrdersAccounts[marketIndex];
+    return openOrders ? &*openOrders : nullptr;
   }
 
   /**
    * deposits - borrows in native terms
    */
-  i80f48 getNet(const RootBankCache& cache, uint64_t tokenIndex) {
-    return (mangoAccountInfo.deposits[tokenIndex] * cache.deposit_index) -
-           (mangoAccountInfo.borrows[tokenIndex] * cache.borrow_index);
+  i80f48 getNet(const RootBankCache& cache, uint64_t tokenIndex) const {
+    return getNet(mangoAccountInfo, cache, tokenIndex);
+  }
+  static i80f48 getNet(const MangoAccountInfo& accountInfo,
+                       const RootBankCache& cache, uint64_t tokenIndex) {
+    return getNet(accountInfo.deposits[tokenIndex],
+                  accountInfo.borrows[tokenIndex], cache);
+  }
+  static i80f48 getNet(i80f48 deposit, i80f48 borrow,
+                       const RootBankCache& cache) {
+    return (deposit * cache.deposit_index) - (borrow * cache.borrow_index);
   }
   /**
    * Return the spot, perps and quote currency values after adjusting for
@@ -58,169 +179,347 @@ struct MangoAccount {
    * @param mangoGroup
    * @param mangoCache
    */
-  auto getHealthComponents(const MangoGroup& mangoGroup,
-                           const MangoCache& mangoCache) {
-    std::vector<i80f48> spot(mangoGroup.numOracles, 0.0L);
-    std::vector<i80f48> perps(mangoGroup.numOracles, 0.0L);
-    auto quote = getNet(mangoCache.root_bank_cache[QUOTE_INDEX], QUOTE_INDEX);
+  HealthComponents getHealthComponents(const MangoGroup& mangoGroup,
+                                       const MangoCache& mangoCache) const {
+    return getHealthComponents(
+        mangoAccountInfo, mangoGroup, mangoCache,
+        [this](uint64_t i) { return getOpenOrders(i); });
+  }
+  /**
+   * Health components of any account
+   * @param findOpenOrders returns the OpenOrders loaded for a market index, or
+   * nullptr
+   */
+  template <typename FindOpenOrders>
+  static HealthComponents getHealthComponents(
+      const MangoAccountInfo& accountInfo, const MangoGroup& mangoGroup,
+      const MangoCache& mangoCache, const FindOpenOrders& findOpenOrders) {
+    HealthComponents components;
+    auto& [spot, perps, quote] = components;
+    quote = getNet(accountInfo, mangoCache.root_bank_cache[QUOTE_INDEX],
+                   QUOTE_INDEX);
     for (uint64_t i = 0; i < mangoGroup.numOracles; i++) {
-      const auto bankCache = mangoCache.root_bank_cache[i];
-      const auto price = mangoCache.price_cache[i].price;
-      const auto baseNet = getNet(bankCache, i);
+      const auto market = getMarketHealthComponents(
+          accountInfo, mangoGroup, mangoCache, i, findOpenOrders);
+      spot[i] = market.spot;
+      perps[i] = market.perp;
+      quote += market.quote;
+    }
+    return components;
+  }
+  /**
+   * Health components of a single market, only depends on the price, root
+   * bank and perp market cache entries of that market
+   * @param findOpenOrders see getHealthComponents
+   */
+  template <typename FindOpenOrders>
+  static MarketHealthComponents getMarketHealthComponents(
+      const MangoAccountInfo& accountInfo, const MangoGroup& mangoGroup,
+      const MangoCache& mangoCache, uint64_t i,
+      const FindOpenOrders& findOpenOrders) {
+    const serum_v3::OpenOrders* spotOpenOrders =
+        accountInfo.inMarginBasket[i] ? findOpenOrders(i) : nullptr;
+    return getMarketHealthComponents(
+        accountInfo.deposits[i], accountInfo.borrows[i], spotOpenOrders,
+        accountInfo.perpAccounts[i], mangoGroup, mangoCache, i);
+  }
+  /**
+   * Health components of a single market from only the account state that
+   * market depends on
+   * @param spotOpenOrders anything with the OpenOrders token totals, nullptr
+   * if the market is not in the margin basket
+   */
+  template <typename OpenOrders>
+  static MarketHealthComponents getMarketHealthComponents(
+      i80f48 deposit, i80f48 borrow, const OpenOrders* spotOpenOrders,
+      const PerpAccountInfo& perpAccount, const MangoGroup& mangoGroup,
+      const MangoCache& mangoCache, uint64_t i) {
+    const auto& perpMarket = mangoGroup.perpMarkets[i];
+    const auto hasPerpMarket =
+        !(perpMarket.perpMarket == solana::PublicKey::empty());
+    return getMarketHealthComponents(
+        deposit, borrow, spotOpenOrders, perpAccount,
+        mangoCache.price_cache[i].price, mangoCache.root_bank_cache[i],
+        hasPerpMarket ? &perpMarket : nullptr,
+        mangoCache.perp_market_cache[i]);
+  }
+  /**
+   * Health components of a single market from the cache and group entries of
+   * that market, for callers that gather them once for many accounts
+   * @param perpMarket nullptr if the group has no perp market at this index
+   */
+  template <typename OpenOrders>
+  static MarketHealthComponents getMarketHealthComponents(
+      i80f48 deposit, i80f48 borrow, const OpenOrders* spotOpenOrders,
+      const PerpAccountInfo& perpAccount, i80f48 price,
+      const RootBankCache& bankCache, const PerpMarketInfo* perpMarket,
+      const PerpMarketCache& perpMarketCache) {
+    MarketHealthComponents market;
+    const auto baseNet = getNet(deposit, borrow, bankCache);
 
-      // Evaluate spot first
-      auto spotOpenOrdersKey = mangoAccountInfo.spotOpenOrders[i].toBase58();
-      if ((spotOpenOrdersAccounts.find(spotOpenOrdersKey) !=
-           spotOpenOrdersAccounts.end()) &&
-          mangoAccountInfo.inMarginBasket[i]) {
-        const auto openOrders = spotOpenOrdersAccounts.at(spotOpenOrdersKey);
-        // C++17 structured bindings :)
-        auto [quoteFree, quoteLocked, baseFree, baseLocked] =
-            splitOpenOrders(openOrders);
+    // Evaluate spot first
+    if (spotOpenOrders) {
+      const auto& openOrders = *spotOpenOrders;
+      // C++17 structured bindings :)
+      auto [quoteFree, quoteLocked, baseFree, baseLocked] =
+          splitOpenOrders(openOrders);
 
-        // base total if all bids were executed
-        const auto bidsBaseNet =
-            baseNet + (quoteLocked / price) + baseFree + baseLocked;
-        // base total if all asks were executed
-        const auto asksBaseNet = baseNet + baseFree;
-        // bids case worse if it has a higher absolute position
-        if (abs(bidsBaseNet.to_double()) > abs(asksBaseNet.to_double())) {
-          spot[i] = bidsBaseNet;
-          quote += quoteFree;
-        } else {
-          spot[i] = asksBaseNet;
-          quote += (baseLocked * price) + quoteFree + quoteLocked;
-        }
+      // base total if all bids were executed
+      const auto bidsBaseNet =
+          baseNet + (quoteLocked / price) + baseFree + baseLocked;
+      // base total if all asks were executed
+      const auto asksBaseNet = baseNet + baseFree;
+      // bids case worse if it has a higher absolute position
+      if (abs(bidsBaseNet.to_double()) > abs(asksBaseNet.to_double())) {
+        market.spot = bidsBaseNet;
+        market.quote += quoteFree;
+        // quoteLocked / price * price doesn't move with the price
+        market.spotPriceSlope = baseNet + baseFree + baseLocked;
       } else {
-        spot[i] = baseNet;
+        market.spot = asksBaseNet;
+        market.quote += (baseLocked * price) + quoteFree + quoteLocked;
+        market.spotPriceSlope = asksBaseNet;
+        market.quotePriceSlope += baseLocked;
       }
-      // Evaluate perps
-      if (!(mangoGroup.perpMarkets[i].perpMarket ==
-            solana::PublicKey::empty())) {
-        const auto perpMarketCache = mangoCache.perp_market_cache[i];
-        const auto perpAccount = mangoAccountInfo.perpAccounts[i];
-        const auto baseLotSize = mangoGroup.perpMarkets[i].baseLotSize;
-        const auto quoteLotSize = mangoGroup.perpMarkets[i].quoteLotSize;
-        const auto takerQuote = perpAccount.takerQuote * quoteLotSize;
-        const auto basePos =
-            ((perpAccount.basePosition + perpAccount.takerBase) * baseLotSize);
-        auto bidsQuantity = perpAccount.bidsQuantity * baseLotSize;
-        auto asksQuantity = perpAccount.asksQuantity * baseLotSize;
-        const auto bidsBaseNet = basePos + bidsQuantity;
-        const auto asksBaseNet = basePos - asksQuantity;
-        if (abs(bidsBaseNet) > abs(asksBaseNet)) {
-          const auto quotePos =
-              (getQuotePosition(perpAccount, perpMarketCache) + takerQuote) -
-              (bidsQuantity * price);
-          quote += quotePos;
-          perps[i] = bidsBaseNet;
-        } else {
-          const auto quotePos = getQuotePosition(perpAccount, perpMarketCache) +
-                                takerQuote + (asksQuantity * price);
-          quote += quotePos;
-          perps[i] = asksBaseNet;
-        }
-
+    } else {
+      market.spot = baseNet;
+      market.spotPriceSlope = baseNet;
+    }
+    // Evaluate perps
+    if (perpMarket) {
+      const auto baseLotSize = perpMarket->baseLotSize;
+      const auto quoteLotSize = perpMarket->quoteLotSize;
+      const auto takerQuote = perpAccount.takerQuote * quoteLotSize;
+      const auto basePos =
+          ((perpAccount.basePosition + perpAccount.takerBase) * baseLotSize);
+      auto bidsQuantity = perpAccount.bidsQuantity * baseLotSize;
+      auto asksQuantity = perpAccount.asksQuantity * baseLotSize;
+      const auto bidsBaseNet = basePos + bidsQuantity;
+      const auto asksBaseNet = basePos - asksQuantity;
+      if (abs(bidsBaseNet) > abs(asksBaseNet)) {
+        const auto quotePos =
+            (getQuotePosition(perpAccount, perpMarketCache) + takerQuote) -
+            (bidsQuantity * price);
+        market.quote += quotePos;
+        market.quotePriceSlope -= bidsQuantity;
+        market.perp = bidsBaseNet;
       } else {
-        perps[i] = 0L;
+        const auto quotePos = getQuotePosition(perpAccount, perpMarketCache) +
+                              takerQuote + (asksQuantity * price);
+        market.quote += quotePos;
+        market.quotePriceSlope += asksQuantity;
+        market.perp = asksBaseNet;
       }
     }
-    return std::make_tuple(spot, perps, quote);
+    return market;
   }
-  static auto getHealthFromComponents(const MangoGroup& mangoGroup,
-                                      const MangoCache& mangoCache,
-                                      std::vector<i80f48> spot,
-                                      std::vector<i80f48> perps, i80f48 quote,
-                                      HealthType healthType) {
-    auto health = quote;
+  PriceSensitivity getPriceSensitivity(const MangoGroup& mangoGroup,
+                                       const MangoCache& mangoCache,
+                                       HealthType healthType) const {
+    return getPriceSensitivity(
+        mangoAccountInfo, mangoGroup, mangoCache, healthType,
+        [this](uint64_t i) { return getOpenOrders(i); });
+  }
+  /**
+   * Price sensitivity of any account, health is identical to getHealth
+   * @param findOpenOrders see getHealthComponents
+   */
+  template <typename FindOpenOrders>
+  static PriceSensitivity getPriceSensitivity(
+      const MangoAccountInfo& accountInfo, const MangoGroup& mangoGroup,
+      const MangoCache& mangoCache, HealthType healthType,
+      const FindOpenOrders& findOpenOrders) {
+    PriceSensitivity sensitivity;
+    sensitivity.numMarkets = mangoGroup.numOracles;
+    sensitivity.health = getNet(
+        accountInfo, mangoCache.root_bank_cache[QUOTE_INDEX], QUOTE_INDEX);
     for (uint64_t i = 0; i < mangoGroup.numOracles; i++) {
+      const auto market = getMarketHealthComponents(
+          accountInfo, mangoGroup, mangoCache, i, findOpenOrders);
       const auto [spotAssetWeight, spotLiabWeight, perpAssetWeight,
                   perpLiabWeight] =
           getMangoGroupWeights(mangoGroup, i, healthType);
       const auto price = mangoCache.price_cache[i].price;
-      const auto spotHealth =
-          (spot[i] * price) * (spot[i] > 0 ? spotAssetWeight : spotLiabWeight);
-      const auto perpHealth = (perps[i] * price) *
-                              (perps[i] > 0 ? perpAssetWeight : perpLiabWeight);
-      health += spotHealth;
-      health += perpHealth;
-      auto a = spot[i];
-      a *= price;
-      a *= (spot[i] > 0 ? spotAssetWeight : spotLiabWeight);
+      sensitivity.health +=
+          market.quote +
+          healthContribution(market.spot, price, spotAssetWeight,
+                             spotLiabWeight) +
+          healthContribution(market.perp, price, perpAssetWeight,
+                             perpLiabWeight);
+      sensitivity.prices[i] = price;
+      sensitivity.slopes[i] =
+          market.spotPriceSlope *
+              (market.spot > 0 ? spotAssetWeight : spotLiabWeight) +
+          market.perp * (market.perp > 0 ? perpAssetWeight : perpLiabWeight) +
+          market.quotePriceSlope;
+    }
+    return sensitivity;
+  }
+  static i80f48 getHealthFromComponents(const MangoGroup& mangoGroup,
+                                        const MangoCache& mangoCache,
+                                        const HealthComponents& components,
+                                        HealthType healthType) {
+    return withHealthType(healthType, [&](auto type) {
+      return getHealthFromComponents<decltype(type)::value>(
+          mangoGroup, mangoCache, components);
+    });
+  }
+  template <HealthType healthType>
+  static i80f48 getHealthFromComponents(const MangoGroup& mangoGroup,
+                                        const MangoCache& mangoCache,
+                                        const HealthComponents& components) {
+    const auto& [spot, perps, quote] = components;
+    auto health = quote;
+    for (uint64_t i = 0; i < mangoGroup.numOracles; i++) {
+      const auto [spotAssetWeight, spotLiabWeight, perpAssetWeight,
+                  perpLiabWeight] =
+          getMangoGroupWeights<healthType>(mangoGroup, i);
+      const auto price = mangoCache.price_cache[i].price;
+      health += healthContribution(spot[i], price, spotAssetWeight,
+                                   spotLiabWeight);
+      health += healthContribution(perps[i], price, perpAssetWeight,
+                                   perpLiabWeight);
     }
     return health;
   }
-  auto getHealth(const MangoGroup& mangoGroup, const MangoCache& mangoCache,
-                 HealthType healthType) {
-    const auto [spot, perps, quote] =
-        getHealthComponents(mangoGroup, mangoCache);
-    const auto health = getHealthFromComponents(mangoGroup, mangoCache, spot,
-                                                perps, quote, healthType);
+  /**
+   * Health with weights from a table built once per group, see GroupWeights
+   */
+  static i80f48 getHealthFromComponents(const MangoGroup& mangoGroup,
+                                        const MangoCache& mangoCache,
+                                        const HealthComponents& components,
+                                        const WeightTable& weights) {
+    const auto& [spot, perps, quote] = components;
+    auto health = quote;
+    for (uint64_t i = 0; i < mangoGroup.numOracles; i++) {
+      const auto price = mangoCache.price_cache[i].price;
+      health += healthContribution(spot[i], price, weights.spotAsset[i],
+                                   weights.spotLiab[i]);
+      health += healthContribution(perps[i], price, weights.perpAsset[i],
+                                   weights.perpLiab[i]);
+    }
     return health;
   }
+  i80f48 getHealth(const MangoGroup& mangoGroup, const MangoCache& mangoCache,
+                   HealthType healthType) const {
+    return withHealthType(healthType, [&](auto type) {
+      return getHealth<decltype(type)::value>(mangoGroup, mangoCache);
+    });
+  }
+  template <HealthType healthType>
+  i80f48 getHealth(const MangoGroup& mangoGroup,
+                   const MangoCache& mangoCache) const {
+    return getHealthFromComponents<healthType>(
+        mangoGroup, mangoCache, getHealthComponents(mangoGroup, mangoCache));
+  }
+  /**
+   * @param weights table of the health type, e.g.
+   * groupWeights.get<HealthType::Maint>()
+   */
+  i80f48 getHealth(const MangoGroup& mangoGroup, const MangoCache& mangoCache,
+                   const WeightTable& weights) const {
+    return getHealthFromComponents(mangoGroup, mangoCache,
+                                   getHealthComponents(mangoGroup, mangoCache),
+                                   weights);
+  }
   /**
    * Take health components and return the assets and liabs weighted
    */
-  static auto getWeightedAssetsLiabsVals(const MangoGroup& mangoGroup,
-                                         const MangoCache& mangoCache,
-                                         std::vector<i80f48> spot,
-                                         std::vector<i80f48> perps,
-                                         i80f48 quote, HealthType healthType) {
+  static std::pair<i80f48, i80f48> getWeightedAssetsLiabsVals(
+      const MangoGroup& mangoGroup, const MangoCache& mangoCache,
+      const HealthComponents& components, HealthType healthType) {
+    return withHealthType(healthType, [&](auto type) {
+      return getWeightedAssetsLiabsVals<decltype(type)::value>(
+          mangoGroup, mangoCache, components);
+    });
+  }
+  template <HealthType healthType>
+  static std::pair<i80f48, i80f48> getWeightedAssetsLiabsVals(
+      const MangoGroup& mangoGroup, const MangoCache& mangoCache,
+      const HealthComponents& components) {
+    const auto& [spot, perps, quote] = components;
     i80f48 assets = 0.0L;
     i80f48 liabs = 0.0L;
-    if (quote > 0) {
-      assets += quote;
-    } else {
-      liabs += (quote * -1);
-    }
+    addWeightedQuote(quote, assets, liabs);
     for (uint64_t i = 0; i < mangoGroup.numOracles; i++) {
       const auto [spotAssetWeight, spotLiabWeight, perpAssetWeight,
                   perpLiabWeight] =
-          getMangoGroupWeights(mangoGroup, i, healthType);
+          getMangoGroupWeights<healthType>(mangoGroup, i);
       const auto price = mangoCache.price_cache[i].price;
-      if (spot[i] > 0) {
-        assets += ((spot[i] * price * spotAssetWeight));
-      } else {
-        liabs += ((spot[i] * -1) * price * spotLiabWeight);
-      }
-
-      if (perps[i] > 0) {
-        assets += (perps[i] * price * perpAssetWeight);
-      } else {
-        liabs += (perps[i] * -1 * price * perpLiabWeight);
-      }
+      addWeighted(spot[i], price, spotAssetWeight, spotLiabWeight, assets,
+                  liabs);
+      addWeighted(perps[i], price, perpAssetWeight, perpLiabWeight, assets,
+                  liabs);
     }
     return std::make_pair(assets, liabs);
   }
   i80f48 getHealthRatio(const MangoGroup& mangoGroup,
-                        const MangoCache& mangoCache, HealthType healthType) {
-    auto [spot, perps, quote] = getHealthComponents(mangoGroup, mangoCache);
-    auto [assets, liabs] = getWeightedAssetsLiabsVals(
-        mangoGroup, mangoCache, spot, perps, quote, healthType);
-    if (liabs > 0) {
-      return ((assets / liabs) - 1) * 100;
-    } else {
-      return 100.0L;
+                        const MangoCache& mangoCache,
+                        HealthType healthType) const {
+    const auto [assets, liabs] = getWeightedAssetsLiabsVals(
+        mangoGroup, mangoCache, getHealthComponents(mangoGroup, mangoCache),
+        healthType);
+    return healthRatio(assets, liabs);
+  }
+  /**
+   * Init and maint health and health ratios from a single evaluation of the
+   * health components, in one pass over the markets
+   */
+  HealthSummary getHealthSummary(const MangoGroup& mangoGroup,
+                                 const MangoCache& mangoCache) const {
+    const auto components = getHealthComponents(mangoGroup, mangoCache);
+    const auto& [spot, perps, quote] = components;
+    i80f48 initAssets = 0.0L, initLiabs = 0.0L;
+    i80f48 maintAssets = 0.0L, maintLiabs = 0.0L;
+    addWeightedQuote(quote, initAssets, initLiabs);
+    addWeightedQuote(quote, maintAssets, maintLiabs);
+    HealthSummary summary;
+    summary.initHealth = quote;
+    summary.maintHealth = quote;
+    for (uint64_t i = 0; i < mangoGroup.numOracles; i++) {
+      const auto& spotMarket = mangoGroup.spotMarkets[i];
+      const auto& perpMarket = mangoGroup.perpMarkets[i];
+      const auto price = mangoCache.price_cache[i].price;
+      summary.initHealth +=
+          healthContribution(spot[i], price, spotMarket.initAssetWeight,
+                             spotMarket.initLiabWeight) +
+          healthContribution(perps[i], price, perpMarket.initAssetWeight,
+                             perpMarket.initLiabWeight);
+      summary.maintHealth +=
+          healthContribution(spot[i], price, spotMarket.maintAssetWeight,
+                             spotMarket.maintLiabWeight) +
+          healthContribution(perps[i], price, perpMarket.maintAssetWeight,
+                             perpMarket.maintLiabWeight);
+      addWeighted(spot[i], price, spotMarket.initAssetWeight,
+                  spotMarket.initLiabWeight, initAssets, initLiabs);
+      addWeighted(perps[i], price, perpMarket.initAssetWeight,
+                  perpMarket.initLiabWeight, initAssets, initLiabs);
+      addWeighted(spot[i], price, spotMarket.maintAssetWeight,
+                  spotMarket.maintLiabWeight, maintAssets, maintLiabs);
+      addWeighted(perps[i], price, perpMarket.maintAssetWeight,
+                  perpMarket.maintLiabWeight, maintAssets, maintLiabs);
     }
+    summary.initHealthRatio = healthRatio(initAssets, initLiabs);
+    summary.maintHealthRatio = healthRatio(maintAssets, maintLiabs);
+    return summary;
   }
 
   bool isLiquidatable(const MangoGroup& mangoGroup,
-                      const MangoCache& mangoCache) {
-    auto initHealth = getHealth(mangoGroup, mangoCache, HealthType::Init);
-    auto maintHealth = getHealth(mangoGroup, mangoCache, HealthType::Maint);
-    return ((mangoAccountInfo.beingLiquidated && initHealth < 0) ||
-            (maintHealth < 0));
+                      const MangoCache& mangoCache) const {
+    const auto summary = getHealthSummary(mangoGroup, mangoCache);
+    return ((mangoAccountInfo.beingLiquidated && summary.initHealth < 0) ||
+            (summary.maintHealth < 0));
   }
   i80f48 computeValue(const MangoGroup& mangoGroup,
                       const MangoCache& mangoCache) {
-    auto a = getAssetsVal(mangoGroup, mangoCache, HealthType::Unknown);
-    auto b = getLiabsVal(mangoGroup, mangoCache, HealthType::Unknown);
+    auto a = getAssetsVal<HealthType::Unknown>(mangoGroup, mangoCache);
+    auto b = getLiabsVal<HealthType::Unknown>(mangoGroup, mangoCache);
     return a - b;
   }
   i80f48 getLeverage(const MangoGroup& mangoGroup,
                      const MangoCache& mangoCache) {
-    auto liabs = getLiabsVal(mangoGroup, mangoCache, HealthType::Unknown);
-    auto assets = getAssetsVal(mangoGroup, mangoCache, HealthType::Unknown);
+    auto liabs = getLiabsVal<HealthType::Unknown>(mangoGroup, mangoCache);
+    auto assets = getAssetsVal<HealthType::Unknown>(mangoGroup, mangoCache);
     if (assets > 0) {
       return liabs / (assets - liabs);
     }
@@ -228,17 +527,20 @@ struct MangoAccount {
   }
   i80f48 getAssetsVal(const MangoGroup& mangoGroup,
                       const MangoCache& mangoCache, HealthType healthType) {
+    return withHealthType(healthType, [&](auto type) {
+      return getAssetsVal<decltype(type)::value>(mangoGroup, mangoCache);
+    });
+  }
+  template <HealthType healthType>
+  i80f48 getAssetsVal(const MangoGroup& mangoGroup,
+                      const MangoCache& mangoCache) {
     i80f48 assetsVal = 0.0L;
     // quote currency deposits
     assetsVal += getUiDeposit(mangoCache.root_bank_cache[QUOTE_INDEX],
                               mangoGroup, QUOTE_INDEX);
     for (uint64_t i = 0; i < mangoGroup.numOracles; i++) {
-      i80f48 assetWeight = 1L;
-      if (healthType == HealthType::Maint) {
-        assetWeight = mangoGroup.spotMarkets[i].maintAssetWeight;
-      } else if (healthType == HealthType::Init) {
-        assetWeight = mangoGroup.spotMarkets[i].initAssetWeight;
-      }
+      const auto assetWeight =
+          std::get<0>(getMangoGroupWeights<healthType>(mangoGroup, i));
       auto spotVal = getSpotVal(mangoGroup, mangoCache, i, assetWeight);
       assetsVal += spotVal;
 
@@ -255,17 +557,20 @@ struct MangoAccount {
   }
   i80f48 getLiabsVal(const MangoGroup& mangoGroup, const MangoCache& mangoCache,
                      HealthType healthType) {
+    return withHealthType(healthType, [&](auto type) {
+      return getLiabsVal<decltype(type)::value>(mangoGroup, mangoCache);
+    });
+  }
+  template <HealthType healthType>
+  i80f48 getLiabsVal(const MangoGroup& mangoGroup,
+                     const MangoCache& mangoCache) {
     i80f48 liabsVal = 0L;
     liabsVal += getUiBorrow(mangoCache.root_bank_cache[QUOTE_INDEX], mangoGroup,
                             QUOTE_INDEX);
     for (uint64_t i = 0; i < mangoGroup.numOracles; ++i) {
-      i80f48 liabWeight = 1;
+      const auto liabWeight =
+          std::get<1>(getMangoGroupWeights<healthType>(mangoGroup, i));
       auto price = getMangoGroupPrice(mangoGroup, i, mangoCache);
-      if (healthType == HealthType::Maint) {
-        liabWeight = mangoGroup.spotMarkets[i].maintLiabWeight;
-      } else if (healthType == HealthType::Init) {
-        liabWeight = mangoGroup.spotMarkets[i].initLiabWeight;
-      }
       liabsVal += getUiBorrow(mangoCache.root_bank_cache[i], mangoGroup, i) *
                   (price * liabWeight);
       const auto perpsUiLiabsVal = nativeI80F48ToUi(
@@ -309,20 +614,49 @@ struct MangoAccount {
         getUiDeposit(mangoCache.root_bank_cache[index], mangoGroup, index) *
         price * assetWeight;
     assetsVal += depositVal;
-    try {
-      const auto openOrdersAccount = spotOpenOrdersAccounts.at(
-          mangoAccountInfo.spotOpenOrders[index].toBase58());
-      assetsVal += nativeToUi(openOrdersAccount.baseTokenTotal,
+    const auto openOrdersAccount = getOpenOrders(index);
+    if (openOrdersAccount) {
+      assetsVal += nativeToUi(openOrdersAccount->baseTokenTotal,
                               mangoGroup.tokens[index].decimals) *
                    price * assetWeight;
-      assetsVal += nativeToUi(openOrdersAccount.quoteTokenTotal +
-                                  openOrdersAccount.referrerRebatesAccrued,
+      assetsVal += nativeToUi(openOrdersAccount->quoteTokenTotal +
+                                  openOrdersAccount->referrerRebatesAccrued,
                               mangoGroup.tokens[QUOTE_INDEX].decimals);
-    } catch (std::out_of_range& e) {
-      return assetsVal;
     }
     return assetsVal;
   }
+
+  /**
+   * weighted value of a base position
+   */
+  static i80f48 healthContribution(i80f48 position, i80f48 price,
+                                   i80f48 assetWeight, i80f48 liabWeight) {
+    return (position * price) * (position > 0 ? assetWeight : liabWeight);
+  }
+
+ private:
+  static void addWeightedQuote(i80f48 quote, i80f48& assets, i80f48& liabs) {
+    if (quote > 0) {
+      assets += quote;
+    } else {
+      liabs += (quote * -1);
+    }
+  }
+  static void addWeighted(i80f48 position, i80f48 price, i80f48 assetWeight,
+                          i80f48 liabWeight, i80f48& assets, i80f48& liabs) {
+    if (position > 0) {
+      assets += ((position * price * assetWeight));
+    } else {
+      liabs += ((position * -1) * price * liabWeight);
+    }
+  }
+  static i80f48 healthRatio(i80f48 assets, i80f48 liabs) {
+    if (liabs > 0) {
+      return ((assets / liabs) - 1) * 100;
+    } else {
+      return 100.0L;
+    }
+  }
 };
 
 }  // namespace mango_v3
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "seqlock.hpp"
+#include "solana.hpp"
+
+namespace solana {
+namespace rpc {
+namespace subscription {
+
+///
+/// Local mirror of accounts of type T, fed by account subscriptions
+///
+/// Keeps the latest decoded AccountInfo<T> of every tracked key together with
+/// the slot it was observed at. Updates from an older slot than the stored one
+/// are dropped, so notifications and http responses can be mixed in any
+/// order. Reads through a Handle are lock-free copies out of a Seqlock, reads
+/// by key additionally look the key up under a shared lock.
+template <typename T>
+class AccountCache {
+ public:
+  using Entry = RpcResponseAndContext<AccountInfo<T>>;
+
+ private:
+  struct Slot {
+    Seqlock<Entry> entry;
+    // serializes writers of this slot, readers never take it
+    std::mutex writer;
+    // context slot of entry, guarded by writer
+    std::optional<uint64_t> contextSlot;
+  };
+
+ public:
+  ///
+  /// Lock-free reader of one cached account
+  class Handle {
+   public:
+    /**
+     * @return latest entry, std::nullopt before the first update
+     */
+    std::optional<Entry> get() const {
+      Entry entry;
+      if (!slot_->entry.load(entry)) return std::nullopt;
+      return entry;
+    }
+    /**
+     * copy the latest entry into out, avoids the optional
+     * @return false before the first update
+     */
+    bool get(Entry &out) const { return slot_->entry.load(out); }
+
+   private:
+    friend class AccountCache;
+    explicit Handle(std::shared_ptr<Slot> slot) : slot_(std::move(slot)) {}
+    std::shared_ptr<Slot> slot_;
+  };
+
+  AccountCache() = default;
+  AccountCache(const AccountCache &) = delete;
+  AccountCache &operator=(const AccountCache &) = delete;
+
+  ~AccountCache() {
+    for (const auto &[subscriber, id] : subscriptions_) {
+      subscriber->removeAccountChangeListener(id);
+    }
+  }
+
+  /**
+   * start caching key without subscribing, e.g. to feed it http responses
+   */
+  Handle track(const PublicKey &key) {
+    std::unique_lock lock(mutex_);
+    auto &slot = slots_[key];
+    if (!slot) slot = std::make_shared<Slot>();
+    return Handle(slot);
+  }
+
+  /**
+   * track key and keep it up to date with account notifications of
+   * subscriber. The subscription ends with the cache
+   */
+  Handle subscribe(WebSocketSubscriber &subscriber, const PublicKey &key,
+                   const Commitment &commitment = Commitment::FINALIZED) {
+    auto handle = track(key);
+    // the callback owns the slot, notifications in flight while the cache is
+    // destroyed stay safe
+    const auto id = subscriber.onAccountChange<T>(
+        key,
+        [slot = handle.slot_](const AccountInfo<T> &info, uint64_t slot_) {
+          update(*slot, Entry{{slot_}, info});
+        },
+        commitment);
+    std::unique_lock lock(mutex_);
+    subscriptions_.emplace_back(&subscriber, id);
+    return handle;
+  }
+
+  /**
+   * store entry unless an entry of a later slot is cached already
+   * @return false if entry was dropped or key isn't tracked
+   */
+  bool update(const PublicKey &key, const Entry &entry) {
+    const auto slot = find(key);
+    return slot && update(*slot, entry);
+  }
+
+  /**
+   * @return latest entry of key, std::nullopt if not tracked or not loaded
+   */
+  std::optional<Entry> get(const PublicKey &key) const {
+    const auto slot = find(key);
+    if (!slot) return std::nullopt;
+    return Handle(slot).get();
+  }
+
+  size_t size() const {
+    std::shared_lock lock(mutex_);
+    return slots_.size();
+  }
+
+  /**
+   * entry of an accountNotification body
+   */
+  static Entry decodeNotification(std::string_view notification) {
+    Entry entry{};
+    entry.context.slot = decodeAccountNotification(notification, entry.value);
+    return entry;
+  }
+
+ private:
+  std::shared_ptr<Slot> find(const PublicKey &key) const {
+    std::shared_lock lock(mutex_);
+    const auto it = slots_.find(key);
+    return it == slots_.end() ? nullptr : it->second;
+  }
+
+  static bool update(Slot &slot, const Entry &entry) {
+    std::lock_guard lock(slot.writer);
+    if (slot.contextSlot && *slot.contextSlot > entry.context.slot) {
+      return false;
+    }
+    slot.contextSlot = entry.context.slot;
+    slot.entry.store(entry);
+    return true;
+  }
+
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<PublicKey, std::shared_ptr<Slot>> slots_;
+  std::vector<std::pair<WebSocketSubscriber *, RequestIdType>> subscriptions_;
+};
+
+}  // namespace subscription
+}  // namespace rpc
+}  // namespace solana
@@ -7,9 +7,11 @@
  * under the terms of the standard MIT license.
  */
 
+#include <algorithm>
 #include <cstdbool>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <string>
 
 namespace solana {
@@ -174,4 +176,96 @@ inline std::string b58encode(const T &str) {
   } else
     return std::string();
 }
-}  // namespace solana
\ No newline at end of file
+
+///
+/// Fixed width codec for 32 byte values like public keys and blockhashes
+///
+/// The value is kept in four big endian 64 bit limbs instead of the byte
+/// arrays above, so there is neither a VLA nor a heap allocation and every
+/// division is by a constant the compiler turns into a multiplication.
+
+/// longest base58 encoding of 32 bytes
+static constexpr size_t B58_32_MAX_SIZE = 44;
+
+/**
+ * encode 32 bytes to base58
+ * @param out receives up to B58_32_MAX_SIZE characters, no null terminator
+ * @return number of characters written
+ */
+inline size_t b58encode32(const uint8_t *bin, char *out) {
+  uint64_t limbs[4];
+  for (size_t i = 0; i < 4; ++i) {
+    uint64_t limb = 0;
+    for (size_t k = 0; k < 8; ++k) limb = limb << 8 | bin[i * 8 + k];
+    limbs[i] = limb;
+  }
+
+  // base 58^5 digits, least significant first, 9 of them cover 2^256. Every
+  // limb is divided in 32 bit halves so the quotient fits 64 bits.
+  static constexpr uint64_t RADIX = 656356768;  // 58^5
+  uint32_t chunks[9];
+  for (auto &chunk : chunks) {
+    uint64_t rem = 0;
+    for (auto &limb : limbs) {
+      const uint64_t hi = rem << 32 | limb >> 32;
+      const uint64_t lo = (hi % RADIX) << 32 | (limb & 0xffffffff);
+      limb = (hi / RADIX) << 32 | lo / RADIX;
+      rem = lo % RADIX;
+    }
+    chunk = static_cast<uint32_t>(rem);
+  }
+
+  uint8_t digits[45];
+  for (size_t c = 0; c < 9; ++c) {
+    auto chunk = chunks[c];
+    for (size_t k = 0; k < 5; ++k, chunk /= 58)
+      digits[44 - c * 5 - k] = chunk % 58;
+  }
+
+  // every leading zero byte is encoded as '1'
+  size_t size = 0;
+  while (size < 32 && !bin[size]) out[size++] = '1';
+  size_t first = 0;
+  while (first < 45 && !digits[first]) ++first;
+  for (; first < 45; ++first) out[size++] = b58digits_ordered[digits[first]];
+  return size;
+}
+
+/**
+ * decode the base58 encoding of 32 bytes into bin
+ * @param decodedSize set to the size of the canonical decoding, like
+ * b58tobin: 32 if b58 is a well formed encoding of 32 bytes
+ * @return false if b58 has an invalid digit or exceeds 32 bytes
+ */
+inline bool b58decode32(const char *b58, size_t len, uint8_t *bin,
+                        size_t *decodedSize) {
+  size_t ones = 0;
+  while (ones < len && b58[ones] == '1') ++ones;
+
+  uint64_t limbs[4] = {};
+  for (size_t i = ones; i < len;) {
+    // up to 10 digits at a time, 58^10 < 2^59
+    uint64_t chunk = 0, scale = 1;
+    for (const auto end = std::min(i + 10, len); i < end; ++i) {
+      const auto digit = static_cast<unsigned char>(b58[i]);
+      if (digit & 0x80 || b58digits_map[digit] == -1) return false;
+      chunk = chunk * 58 + b58digits_map[digit];
+      scale *= 58;
+    }
+    unsigned __int128 carry = chunk;
+    for (size_t j = 4; j--;) {
+      carry += static_cast<unsigned __int128>(limbs[j]) * scale;
+      limbs[j] = static_cast<uint64_t>(carry);
+      carry >>= 64;
+    }
+    if (carry) return false;
+  }
+
+  for (size_t i = 0; i < 4; ++i)
+    for (size_t k = 0; k < 8; ++k) bin[i * 8 + k] = limbs[i] >> (56 - 8 * k);
+  size_t zeros = 0;
+  while (zeros < 32 && !bin[zeros]) ++zeros;
+  *decodedSize = 32 - zeros + ones;
+  return true;
+}
+}  // namespace solana
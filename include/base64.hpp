@@ -1,7 +1,15 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SOLANA_B64_X86 1
+#endif
+
 const std::string BASE64 = "base64";
 
 namespace solana {
@@ -17,14 +25,240 @@ static constexpr int B64index[256] = {
     25, 0,  0,  0,  0,  63, 0,  26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36,
     37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51};
 
-inline const std::string b64encode(const void *data, const size_t &len) {
-  std::string result((len + 2) / 3 * 4, '=');
+/**
+ * instruction sets the base64 kernels are available for
+ */
+enum class B64Kernel { SCALAR, SSE4, AVX2 };
+
+/**
+ * @return true if kernel can run on this cpu
+ */
+inline bool b64kernelSupported(B64Kernel kernel) {
+  switch (kernel) {
+    case B64Kernel::SCALAR:
+      return true;
+#ifdef SOLANA_B64_X86
+    case B64Kernel::SSE4:
+      return __builtin_cpu_supports("sse4.1");
+    case B64Kernel::AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+/**
+ * fastest kernel supported by this cpu, detected on first use
+ */
+inline B64Kernel b64bestKernel() {
+  static const B64Kernel best = b64kernelSupported(B64Kernel::AVX2)
+                                    ? B64Kernel::AVX2
+                                    : b64kernelSupported(B64Kernel::SSE4)
+                                          ? B64Kernel::SSE4
+                                          : B64Kernel::SCALAR;
+  return best;
+}
+
+#ifdef SOLANA_B64_X86
+///
+/// Vectorized kernels, after Mula & Lemire, "Faster Base64 Encoding and
+/// Decoding using AVX2 Instructions"
+///
+/// Every kernel converts a prefix of its input and returns the number of
+/// input bytes it consumed, the scalar code takes over from there. Decoding
+/// stops at the first block holding anything but the standard alphabet, so
+/// the scalar table still decides how lenient decoding is.
+
+/**
+ * 12 bytes, loaded as 16, to the 16 six bit indices of their characters
+ */
+__attribute__((target("sse4.1"))) inline __m128i b64encodeIndicesSse4(
+    __m128i in) {
+  in = _mm_shuffle_epi8(
+      in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+/**
+ * six bit indices to characters of the standard alphabet
+ */
+__attribute__((target("sse4.1"))) inline __m128i b64encodeCharsSse4(
+    __m128i indices) {
+  const __m128i offsets =
+      _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                    '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+__attribute__((target("sse4.1"))) inline size_t b64encodeSse4(
+    const unsigned char *in, size_t len, char *out) {
+  size_t i = 0, j = 0;
+  for (; i + 16 <= len; i += 12, j += 16) {
+    const __m128i block = _mm_loadu_si128((const __m128i *)(in + i));
+    _mm_storeu_si128((__m128i *)(out + j),
+                     b64encodeCharsSse4(b64encodeIndicesSse4(block)));
+  }
+  return i;
+}
+
+/**
+ * 16 characters to six bit indices
+ * @return false if a character is not part of the standard alphabet
+ */
+__attribute__((target("sse4.1"))) inline bool b64decodeIndicesSse4(
+    __m128i &in) {
+  const __m128i lutLo =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lutHi =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lutRoll =
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+  const __m128i lo = _mm_shuffle_epi8(lutLo, _mm_and_si128(in, nibble));
+  const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+  if (!_mm_testz_si128(lo, hi)) return false;
+  const __m128i isSlash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+  const __m128i roll =
+      _mm_shuffle_epi8(lutRoll, _mm_add_epi8(isSlash, hiNibbles));
+  in = _mm_add_epi8(in, roll);
+  return true;
+}
+
+/**
+ * 16 six bit indices to 12 bytes, followed by 4 zero bytes
+ */
+__attribute__((target("sse4.1"))) inline __m128i b64decodePackSse4(
+    __m128i indices) {
+  const __m128i merged =
+      _mm_maddubs_epi16(indices, _mm_set1_epi32(0x01400140));
+  const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(
+      packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+                            -1));
+}
+
+__attribute__((target("sse4.1"))) inline size_t b64decodeSse4(
+    const unsigned char *in, size_t len, unsigned char *out, size_t outLen) {
+  size_t i = 0, j = 0;
+  for (; i + 16 <= len && j + 16 <= outLen; i += 16, j += 12) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(in + i));
+    if (!b64decodeIndicesSse4(block)) break;
+    _mm_storeu_si128((__m128i *)(out + j), b64decodePackSse4(block));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) inline size_t b64encodeAvx2(
+    const unsigned char *in, size_t len, char *out) {
+  const __m256i shuffle = _mm256_set_epi8(
+      10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1, 10, 11, 9, 10, 7, 8,
+      6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+  const __m256i offsets = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  size_t i = 0, j = 0;
+  for (; i + 28 <= len; i += 24, j += 32) {
+    // 12 bytes per 128 bit lane
+    __m256i block = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+        _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+    block = _mm256_shuffle_epi8(block, shuffle);
+    const __m256i t0 = _mm256_and_si256(block, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(block, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range =
+        _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    _mm256_storeu_si256(
+        (__m256i *)(out + j),
+        _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) inline size_t b64decodeAvx2(
+    const unsigned char *in, size_t len, unsigned char *out, size_t outLen) {
+  const __m256i lutLo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+      0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lutHi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lutRoll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4,
+      -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4,
+      10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  size_t i = 0, j = 0;
+  for (; i + 32 <= len && j + 32 <= outLen; i += 32, j += 24) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(in + i));
+    const __m256i hiNibbles =
+        _mm256_and_si256(_mm256_srli_epi32(block, 4), nibble);
+    const __m256i lo =
+        _mm256_shuffle_epi8(lutLo, _mm256_and_si256(block, nibble));
+    const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+    if (!_mm256_testz_si256(lo, hi)) break;
+    const __m256i isSlash = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('/'));
+    const __m256i roll =
+        _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(isSlash, hiNibbles));
+    block = _mm256_add_epi8(block, roll);
+    const __m256i merged =
+        _mm256_maddubs_epi16(block, _mm256_set1_epi32(0x01400140));
+    block = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    block = _mm256_shuffle_epi8(block, pack);
+    // move the 12 bytes of the upper lane right behind those of the lower one
+    block = _mm256_permutevar8x32_epi32(
+        block, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256((__m256i *)(out + j), block);
+  }
+  return i;
+}
+#endif
+
+/**
+ * number of characters len bytes encode to, including padding
+ */
+inline size_t b64encodedSize(const size_t &len) { return (len + 2) / 3 * 4; }
+
+/**
+ * encode base64 into out, which has to hold b64encodedSize(len) characters
+ */
+inline void b64encode(const void *data, const size_t &len, char *out,
+                      B64Kernel kernel = b64bestKernel()) {
   unsigned char *p = (unsigned char *)data;
-  char *str = &result[0];
-  size_t j = 0, pad = len % 3;
+  char *str = out;
+  size_t pad = len % 3;
   const size_t last = len - pad;
+  size_t i = 0;
+#ifdef SOLANA_B64_X86
+  if (kernel == B64Kernel::AVX2) i = b64encodeAvx2(p, last, str);
+  if (kernel != B64Kernel::SCALAR)
+    i += b64encodeSse4(p + i, last - i, str + i / 3 * 4);
+#endif
+  size_t j = i / 3 * 4;
 
-  for (size_t i = 0; i < last; i += 3) {
+  for (; i < last; i += 3) {
     int n = int(p[i]) << 16 | int(p[i + 1]) << 8 | p[i + 2];
     str[j++] = B64chars[n >> 18];
     str[j++] = B64chars[n >> 12 & 0x3F];
@@ -37,21 +271,67 @@ inline const std::string b64encode(const void *data, const size_t &len) {
     str[j++] = B64chars[pad ? n >> 10 & 0x3F : n >> 2];
     str[j++] = B64chars[pad ? n >> 4 & 0x03F : n << 4 & 0x3F];
     str[j++] = pad ? B64chars[n << 2 & 0x3F] : '=';
+    str[j++] = '=';
   }
+}
+
+/**
+ * encode base64 into a caller supplied buffer of capacity characters
+ * @return number of characters written
+ */
+inline size_t b64encode(const void *data, const size_t &len, char *out,
+                        const size_t &capacity) {
+  const auto size = b64encodedSize(len);
+  if (capacity < size)
+    throw std::runtime_error("base64 buffer too small '" +
+                             std::to_string(capacity) + " < " +
+                             std::to_string(size) + "'");
+  b64encode(data, len, out);
+  return size;
+}
+
+inline const std::string b64encode(const void *data, const size_t &len) {
+  std::string result(b64encodedSize(len), '=');
+  b64encode(data, len, &result[0]);
   return result;
 }
 
-inline const std::string b64decode(const void *data, const size_t &len) {
-  if (len == 0) return "";
+/**
+ * number of bytes decoded from len characters of base64
+ */
+inline size_t b64decodedSize(const void *data, const size_t &len) {
+  if (len == 0) return 0;
 
   unsigned char *p = (unsigned char *)data;
-  size_t j = 0, pad1 = len % 4 || p[len - 1] == '=',
+  size_t pad1 = len % 4 || p[len - 1] == '=',
          pad2 = pad1 && (len % 4 > 2 || p[len - 2] != '=');
   const size_t last = (len - pad1) / 4 << 2;
-  std::string result(last / 4 * 3 + pad1 + pad2, '\0');
-  unsigned char *str = (unsigned char *)&result[0];
+  return last / 4 * 3 + pad1 + pad2;
+}
+
+/**
+ * decode base64 into out, which has to hold b64decodedSize(data, len) bytes
+ */
+inline void b64decode(const void *data, const size_t &len, void *out,
+                      B64Kernel kernel = b64bestKernel()) {
+  if (len == 0) return;
+
+  unsigned char *p = (unsigned char *)data;
+  size_t pad1 = len % 4 || p[len - 1] == '=',
+         pad2 = pad1 && (len % 4 > 2 || p[len - 2] != '=');
+  const size_t last = (len - pad1) / 4 << 2;
+  unsigned char *str = (unsigned char *)out;
+  size_t i = 0;
+#ifdef SOLANA_B64_X86
+  // the padded tail is always left to the scalar code
+  const size_t size = last / 4 * 3 + pad1 + pad2;
+  if (kernel == B64Kernel::AVX2) i = b64decodeAvx2(p, last, str, size);
+  if (kernel != B64Kernel::SCALAR)
+    i += b64decodeSse4(p + i, last - i, str + i / 4 * 3, size - i / 4 * 3);
+#endif
+  size_t j = i / 4 * 3;
 
-  for (size_t i = 0; i < last; i += 4) {
+  for (; i < last; i += 4) {
     int n = B64index[p[i]] << 18 | B64index[p[i + 1]] << 12 |
             B64index[p[i + 2]] << 6 | B64index[p[i + 3]];
     str[j++] = n >> 16;
@@ -66,6 +346,26 @@ inline const std::string b64decode(const void *data, const size_t &len) {
       str[j++] = n >> 8 & 0xFF;
     }
   }
+}
+
+/**
+ * decode base64 into a caller supplied buffer of capacity bytes
+ * @return number of bytes written
+ */
+inline size_t b64decode(const void *data, const size_t &len, void *out,
+                        const size_t &capacity) {
+  const auto size = b64decodedSize(data, len);
+  if (capacity < size)
+    throw std::runtime_error("base64 buffer too small '" +
+                             std::to_string(capacity) + " < " +
+                             std::to_string(size) + "'");
+  b64decode(data, len, out);
+  return size;
+}
+
+inline const std::string b64decode(const void *data, const size_t &len) {
+  std::string result(b64decodedSize(data, len), '\0');
+  b64decode(data, len, &result[0]);
   return result;
 }
 
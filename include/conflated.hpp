@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace solana {
+
+///
+/// Latest value of a feed, for consumers that only care about the newest
+/// state
+///
+/// A producer publishes values tagged with their slot. Every publish
+/// overwrites the single stored value, unless that one is from a later slot.
+/// A consumer takes the value at its own pace and skips everything published
+/// in between. It is woken once per update it hasn't taken yet, no matter
+/// how many publishes it slept through. Publishing swaps buffers instead of
+/// copying, so a producer can decode straight into its own buffer.
+template <typename T>
+class Conflated {
+ public:
+  struct Counters {
+    // values published
+    uint64_t updates;
+    // values overwritten before the consumer took them
+    uint64_t conflated;
+    // values dropped because a later slot was published already
+    uint64_t stale;
+  };
+
+  Conflated() : latest_(std::make_unique<T>()) {}
+
+  /**
+   * publish value, swapping it with the buffer of the value it replaces
+   * @return false if value is older than the stored one and was dropped
+   */
+  bool publish(std::unique_ptr<T> &value, uint64_t slot) {
+    {
+      std::lock_guard lock(mutex_);
+      if (published_ && slot < slot_) {
+        stale_++;
+        return false;
+      }
+      std::swap(latest_, value);
+      slot_ = slot;
+      published_ = true;
+      updates_++;
+      if (pending_) {
+        conflated_++;
+        return true;
+      }
+      pending_ = true;
+    }
+    wakeup_.notify_one();
+    return true;
+  }
+
+  bool publish(const T &value, uint64_t slot) {
+    auto copy = std::make_unique<T>(value);
+    return publish(copy, slot);
+  }
+
+  /**
+   * copy the latest value into out if it wasn't taken yet
+   * @return false if there is no new value
+   */
+  bool take(T &out, uint64_t &slot) {
+    std::lock_guard lock(mutex_);
+    return takeLocked(out, slot);
+  }
+
+  /**
+   * wait up to timeout for a value that wasn't taken yet
+   * @return false on timeout
+   */
+  template <typename Rep, typename Period>
+  bool wait(T &out, uint64_t &slot,
+            const std::chrono::duration<Rep, Period> &timeout) {
+    std::unique_lock lock(mutex_);
+    if (!wakeup_.wait_for(lock, timeout, [this]() { return pending_; })) {
+      return false;
+    }
+    return takeLocked(out, slot);
+  }
+
+  Counters counters() const {
+    std::lock_guard lock(mutex_);
+    return {updates_, conflated_, stale_};
+  }
+
+ private:
+  bool takeLocked(T &out, uint64_t &slot) {
+    if (!pending_) return false;
+    out = *latest_;
+    slot = slot_;
+    pending_ = false;
+    return true;
+  }
+
+  mutable std::mutex mutex_;
+  std::condition_variable wakeup_;
+  std::unique_ptr<T> latest_;
+  uint64_t slot_ = 0;
+  bool published_ = false;
+  // published but not taken yet
+  bool pending_ = false;
+  uint64_t updates_ = 0;
+  uint64_t conflated_ = 0;
+  uint64_t stale_ = 0;
+};
+
+}  // namespace solana
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace solana {
+
+///
+/// Bounded lock-free queue
+///
+/// Every cell carries a sequence number telling producers and consumers
+/// whose turn it is, so any number of threads may push and pop without
+/// locks. try_push fails when full, try_pop when empty. The capacity is
+/// rounded up to a power of two.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    cells_ = std::vector<Cell>(size);
+    for (size_t i = 0; i < size; i++) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    mask_ = size - 1;
+  }
+
+  bool try_push(T &&value) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &cell = cells_[pos & mask_];
+      const auto seq = cell.seq.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_pop(T &value) {
+    auto pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &cell = cells_[pos & mask_];
+      const auto seq = cell.seq.load(std::memory_order_acquire);
+      const auto diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          value = std::move(cell.value);
+          cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq{0};
+    T value{};
+  };
+
+  std::vector<Cell> cells_;
+  size_t mask_ = 0;
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<size_t> head_{0};
+};
+
+/// @brief what a producer does when a worker's queue is full
+enum class OverflowPolicy {
+  // wait for the worker, which slows down the producer
+  Block,
+  // drop the oldest queued task of the worker
+  DropOldest,
+  // keep only the latest task per key until the worker catches up
+  Conflate,
+};
+
+struct DispatchOptions {
+  // number of worker threads, 0 runs tasks inline on the producer
+  size_t workers = 0;
+  // capacity of every worker's queue
+  size_t queue_capacity = 4096;
+  OverflowPolicy overflow = OverflowPolicy::Block;
+};
+
+struct DispatchStats {
+  // tasks pushed by the producer
+  uint64_t pushed;
+  // tasks dropped by OverflowPolicy::DropOldest
+  uint64_t dropped;
+  // tasks replaced by a newer one of the same key
+  uint64_t conflated;
+};
+
+///
+/// Worker threads running tasks pushed by one producer thread
+///
+/// Tasks with the same key always go to the same worker and run in the order
+/// they were pushed. Each worker owns a BoundedQueue. When it is full the
+/// OverflowPolicy applies. Conflated tasks wait on the producer side, and
+/// flush() moves them on once there is room. Idle workers spin briefly, then
+/// sleep until the producer wakes them.
+///
+/// Task needs a `key` member and has to be default constructible and
+/// movable.
+template <typename Task>
+class DispatchPool {
+ public:
+  using Handler = std::function<void(Task &)>;
+
+  DispatchPool(DispatchOptions options, Handler handler)
+      : options_(options), handler_(std::move(handler)) {
+    for (size_t i = 0; i < options_.workers; i++) {
+      workers_.push_back(std::make_unique<Worker>(options_.queue_capacity));
+    }
+    for (auto &worker : workers_) {
+      worker->thread = std::thread([this, w = worker.get()]() { run(*w); });
+    }
+  }
+
+  DispatchPool(const DispatchPool &) = delete;
+  DispatchPool &operator=(const DispatchPool &) = delete;
+
+  ~DispatchPool() {
+    stop_.store(true);
+    for (auto &worker : workers_) wake(*worker, true);
+    for (auto &worker : workers_) worker->thread.join();
+  }
+
+  /**
+   * queue task on the worker of its key, only called by the producer thread
+   */
+  void push(Task &&task) {
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    auto &worker = *workers_[index(task.key)];
+    flush(worker);
+    // a newer task replaces a conflated one, that keeps the order per key
+    const auto pending = worker.conflated.find(task.key);
+    if (pending != worker.conflated.end()) {
+      pending->second = std::move(task);
+      conflated_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    if (!worker.queue.try_push(std::move(task))) overflow(worker, task);
+    wake(worker, false);
+  }
+
+  /**
+   * queue conflated tasks where there is room again
+   * @return true if some are still waiting
+   */
+  bool flush() {
+    bool pending = false;
+    for (auto &worker : workers_) {
+      flush(*worker);
+      pending = pending || !worker->conflated.empty();
+    }
+    return pending;
+  }
+
+  DispatchStats stats() const {
+    return {pushed_.load(std::memory_order_relaxed),
+            dropped_.load(std::memory_order_relaxed),
+            conflated_.load(std::memory_order_relaxed)};
+  }
+
+ private:
+  struct Worker {
+    explicit Worker(size_t capacity) : queue(capacity) {}
+    BoundedQueue<Task> queue;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::atomic<bool> sleeping{false};
+    // latest task per key that didn't fit, owned by the producer
+    std::unordered_map<uint64_t, Task> conflated;
+    std::thread thread;
+  };
+
+  // keys are often sequential or share a stride, mix them first
+  size_t index(uint64_t key) const {
+    return ((key * 11400714819323198485ull) >> 32) % workers_.size();
+  }
+
+  void overflow(Worker &worker, Task &task) {
+    switch (options_.overflow) {
+      case OverflowPolicy::Block:
+        while (!worker.queue.try_push(std::move(task))) {
+          wake(worker, false);
+          std::this_thread::yield();
+        }
+        break;
+      case OverflowPolicy::DropOldest: {
+        Task oldest;
+        while (!worker.queue.try_push(std::move(task))) {
+          if (worker.queue.try_pop(oldest)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+        break;
+      }
+      case OverflowPolicy::Conflate:
+        worker.conflated.emplace(task.key, std::move(task));
+        break;
+    }
+  }
+
+  void flush(Worker &worker) {
+    bool flushed = false;
+    for (auto it = worker.conflated.begin(); it != worker.conflated.end();) {
+      if (!worker.queue.try_push(std::move(it->second))) break;
+      it = worker.conflated.erase(it);
+      flushed = true;
+    }
+    if (flushed) wake(worker, false);
+  }
+
+  static void wake(Worker &worker, bool always) {
+    // orders the push before reading sleeping, see run
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!always && !worker.sleeping.load()) return;
+    std::lock_guard lock(worker.mutex);
+    worker.wakeup.notify_one();
+  }
+
+  void run(Worker &worker) {
+    Task task;
+    unsigned idle = 0;
+    while (!stop_.load(std::memory_order_relaxed)) {
+      if (worker.queue.try_pop(task)) {
+        idle = 0;
+        invoke(task);
+        continue;
+      }
+      if (++idle < 128) {
+        std::this_thread::yield();
+        continue;
+      }
+      // sleeping is set before looking at the queue once more, a producer
+      // pushing meanwhile sees it and wakes this worker
+      std::unique_lock lock(worker.mutex);
+      worker.sleeping.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      worker.wakeup.wait(lock, [&]() {
+        return stop_.load() || worker.queue.try_pop(task);
+      });
+      worker.sleeping.store(false);
+      if (stop_.load()) break;
+      idle = 0;
+      lock.unlock();
+      invoke(task);
+    }
+  }
+
+  // an exception only fails its own task
+  void invoke(Task &task) {
+    try {
+      handler_(task);
+    } catch (const std::exception &e) {
+      std::cerr << "An exception was caught while dispatching: " << e.what()
+                << std::endl;
+    } catch (...) {
+      // anything else would terminate the worker thread
+      std::cerr << "An unknown exception was caught while dispatching"
+                << std::endl;
+    }
+  }
+
+  DispatchOptions options_;
+  Handler handler_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<bool> stop_{false};
+  std::atomic<uint64_t> pushed_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> conflated_{0};
+};
+
+}  // namespace solana
@@ -74,6 +74,21 @@ struct type_from_size<128> {
   using signed_type = __int128;
   using next_size = type_from_size<256>;
 };
+#define FIXED_HAS_INT128
+#endif
+
+// sizes without a native next size that have dedicated multiply and divide
+// kernels below, instead of the generic fallbacks
+template <size_t T>
+struct has_limb_kernels {
+  static constexpr bool value = false;
+};
+
+#ifdef FIXED_HAS_INT128
+template <>
+struct has_limb_kernels<128> {
+  static constexpr bool value = true;
+};
 #endif
 
 template <>
@@ -156,7 +171,8 @@ template <size_t I, size_t F>
 CONSTEXPR14 fixed<I, F> divide(
     fixed<I, F> numerator, fixed<I, F> denominator, fixed<I, F> &remainder,
     typename std::enable_if<
-        !type_from_size<I + F>::next_size::is_specialized>::type * = nullptr) {
+        !type_from_size<I + F>::next_size::is_specialized &&
+        !has_limb_kernels<I + F>::value>::type * = nullptr) {
   using base_type = typename fixed<I, F>::base_type;
   using unsigned_type = typename fixed<I, F>::unsigned_type;
 
@@ -246,7 +262,8 @@ template <size_t I, size_t F>
 CONSTEXPR14 fixed<I, F> multiply(
     fixed<I, F> lhs, fixed<I, F> rhs,
     typename std::enable_if<
-        !type_from_size<I + F>::next_size::is_specialized>::type * = nullptr) {
+        !type_from_size<I + F>::next_size::is_specialized &&
+        !has_limb_kernels<I + F>::value>::type * = nullptr) {
   using base_type = typename fixed<I, F>::base_type;
 
   constexpr size_t fractional_bits = fixed<I, F>::fractional_bits;
@@ -267,8 +284,160 @@ CONSTEXPR14 fixed<I, F> multiply(
   return fixed<I, F>::from_base((x1 << fractional_bits) + (x3 + x2) +
                                 (x4 >> fractional_bits));
 }
+
+#ifdef FIXED_HAS_INT128
+// 128 bit kernels working on 64 bit limbs, they give the same results as a
+// native 256 bit type would: the product is floored and the quotient
+// truncated towards zero like the rust fixed crate does, wrapping on overflow
+
+// bits [F, F + 128) of the 256 bit product lhs * rhs
+template <size_t F>
+CONSTEXPR14 __int128 multiply_128(__int128 lhs, __int128 rhs) {
+  static_assert(F > 0 && F < 128, "invalid fractional bits");
+  using u128 = unsigned __int128;
+
+  const u128 a = lhs;
+  const u128 b = rhs;
+  const uint64_t a0 = a, a1 = a >> 64, b0 = b, b1 = b >> 64;
+  const u128 p00 = static_cast<u128>(a0) * b0;
+  const u128 p01 = static_cast<u128>(a0) * b1;
+  const u128 p10 = static_cast<u128>(a1) * b0;
+  const u128 mid = (p00 >> 64) + static_cast<uint64_t>(p01) +
+                   static_cast<uint64_t>(p10);
+  const u128 lo = mid << 64 | static_cast<uint64_t>(p00);
+  u128 hi = (mid >> 64) + (p01 >> 64) + (p10 >> 64) +
+            static_cast<u128>(a1) * b1;
+  // the limbs above treat both operands as unsigned, a negative operand
+  // contributed an extra 2^128 times the other one. Masks instead of branches,
+  // signs are unpredictable in health math.
+  hi -= b & static_cast<u128>(lhs >> 127);
+  hi -= a & static_cast<u128>(rhs >> 127);
+  return static_cast<__int128>(lo >> F | hi << (128 - F));
+}
+
+// (n << F) / d of unsigned values, the quotient modulo 2^128
+template <size_t F>
+CONSTEXPR14 unsigned __int128 divide_shifted_128(unsigned __int128 n,
+                                                 unsigned __int128 d,
+                                                 unsigned __int128 &remainder) {
+  static_assert(F > 0 && F <= 64, "invalid fractional bits");
+  using u128 = unsigned __int128;
+
+  // shifted numerator still fits 128 bits, a single native division
+  if (n >> (128 - F) == 0) {
+    remainder = (n << F) % d;
+    return (n << F) / d;
+  }
+
+  // numerator limbs, least significant first
+  const uint64_t u[3] = {static_cast<uint64_t>(n << F),
+                         static_cast<uint64_t>((n << F) >> 64),
+                         static_cast<uint64_t>(n >> (128 - F))};
+
+  if (d >> 64 == 0) {
+    // short division by a single limb
+    const uint64_t d0 = d;
+    u128 q = 0, r = 0;
+    for (int i = 2; i >= 0; --i) {
+      const u128 cur = r << 64 | u[i];
+      q = q << 64 | static_cast<uint64_t>(cur / d0);
+      r = cur % d0;
+    }
+    remainder = r;
+    return q;
+  }
+
+  // Knuth's algorithm D, see Hacker's Delight divmnu, with 64 bit digits: a
+  // 3 limb numerator by a 2 limb divisor gives a 2 limb quotient
+  const int s = __builtin_clzll(static_cast<uint64_t>(d >> 64));
+  const u128 dn = d << s;
+  const uint64_t v[2] = {static_cast<uint64_t>(dn),
+                         static_cast<uint64_t>(dn >> 64)};
+  // (x >> 1) >> (63 - s) is x >> (64 - s) without the undefined shift by 64
+  uint64_t un[4] = {u[0] << s, u[1] << s | (u[0] >> 1) >> (63 - s),
+                    u[2] << s | (u[1] >> 1) >> (63 - s),
+                    (u[2] >> 1) >> (63 - s)};
+  uint64_t q[2] = {};
+  for (int j = 1; j >= 0; --j) {
+    // estimate the quotient digit, it is at most 2 too large
+    const u128 num = static_cast<u128>(un[j + 2]) << 64 | un[j + 1];
+    u128 qhat = num / v[1];
+    u128 rhat = num - qhat * v[1];
+    while (qhat >> 64 || qhat * v[0] > (rhat << 64 | un[j])) {
+      qhat--;
+      rhat += v[1];
+      if (rhat >> 64) break;
+    }
+
+    // multiply and subtract
+    __int128 k = 0, t = 0;
+    for (int i = 0; i < 2; ++i) {
+      const u128 p = qhat * v[i];
+      t = static_cast<__int128>(un[i + j]) - k -
+          static_cast<__int128>(static_cast<uint64_t>(p));
+      un[i + j] = static_cast<uint64_t>(t);
+      k = static_cast<__int128>(p >> 64) - (t >> 64);
+    }
+    t = static_cast<__int128>(un[j + 2]) - k;
+    un[j + 2] = static_cast<uint64_t>(t);
+    q[j] = static_cast<uint64_t>(qhat);
+
+    // the estimate was one too large, add the divisor back
+    if (t < 0) {
+      q[j]--;
+      u128 carry = 0;
+      for (int i = 0; i < 2; ++i) {
+        const u128 sum = static_cast<u128>(un[i + j]) + v[i] + carry;
+        un[i + j] = static_cast<uint64_t>(sum);
+        carry = sum >> 64;
+      }
+      un[j + 2] += static_cast<uint64_t>(carry);
+    }
+  }
+  remainder = (static_cast<u128>(un[1]) << 64 | un[0]) >> s;
+  return static_cast<u128>(q[1]) << 64 | q[0];
+}
+
+template <size_t I, size_t F>
+CONSTEXPR14 fixed<I, F> divide(
+    fixed<I, F> numerator, fixed<I, F> denominator, fixed<I, F> &remainder,
+    typename std::enable_if<has_limb_kernels<I + F>::value>::type * =
+        nullptr) {
+  using unsigned_type = typename fixed<I, F>::unsigned_type;
+
+  if (denominator == 0) {
+    throw divide_by_zero();
+  }
+
+  const bool negative_numerator = numerator < 0;
+  const bool negative = negative_numerator != (denominator < 0);
+  const unsigned_type n =
+      negative_numerator ? -static_cast<unsigned_type>(numerator.to_raw())
+                         : numerator.to_raw();
+  const unsigned_type d =
+      denominator < 0 ? -static_cast<unsigned_type>(denominator.to_raw())
+                      : denominator.to_raw();
+
+  unsigned_type r = 0;
+  const unsigned_type q = divide_shifted_128<F>(n, d, r);
+  remainder = fixed<I, F>::from_base(negative_numerator ? -r : r);
+  return fixed<I, F>::from_base(negative ? -q : q);
+}
+
+template <size_t I, size_t F>
+CONSTEXPR14 fixed<I, F> multiply(
+    fixed<I, F> lhs, fixed<I, F> rhs,
+    typename std::enable_if<has_limb_kernels<I + F>::value>::type * =
+        nullptr) {
+  return fixed<I, F>::from_base(
+      multiply_128<F>(lhs.to_raw(), rhs.to_raw()));
+}
+#endif
 }  // namespace detail
 
+// at most 8 byte aligned: account layouts embed i80f48 in structs packed to
+// 8 bytes, where a 16 byte aligned __int128 member would be misaligned
+#pragma pack(push, 8)
 template <size_t I, size_t F>
 class fixed {
   static_assert(detail::type_from_size<I + F>::is_specialized,
@@ -467,13 +636,15 @@ class fixed {
 
  public:
   CONSTEXPR14 void swap(fixed &rhs) {
-    using std::swap;
-    swap(data_, rhs.data_);
+    const base_type tmp = data_;
+    data_ = rhs.data_;
+    rhs.data_ = tmp;
   }
 
  public:
   base_type data_ = 0;
 };
+#pragma pack(pop)
 
 // if we have the same fractional portion, but differing integer portions, we
 // trivially upgrade the smaller type
@@ -708,5 +879,6 @@ constexpr bool operator!=(Number lhs, fixed<I, F> rhs) {
 }  // namespace numeric
 
 #undef CONSTEXPR14
+#undef FIXED_HAS_INT128
 typedef numeric::fixed<80, 48> i80f48;
 #endif
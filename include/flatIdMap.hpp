@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace solana {
+
+///
+/// Immutable hash map from integer ids to values
+///
+/// Open addressing with linear probing over one contiguous array kept at most
+/// half full, so a lookup is a multiply, a shift and usually a single cache
+/// line. Built once from all entries and never modified, which makes it safe
+/// to read from any thread once published. Meant to be rebuilt and swapped on
+/// the rare writes of a read-mostly table.
+template <typename Value>
+class FlatIdMap {
+ public:
+  FlatIdMap() = default;
+
+  /**
+   * build the map, ids must be unique
+   */
+  explicit FlatIdMap(const std::vector<std::pair<uint64_t, Value>> &entries) {
+    std::size_t capacity = 2;
+    shift_ = 63;
+    while (capacity < 2 * entries.size()) {
+      capacity *= 2;
+      shift_--;
+    }
+    slots_.resize(capacity);
+    for (const auto &[id, value] : entries) {
+      auto i = index(id);
+      while (slots_[i].occupied) i = (i + 1) & (capacity - 1);
+      slots_[i] = {id, true, value};
+    }
+    size_ = entries.size();
+  }
+
+  /**
+   * @return the value of id, nullptr if there is none
+   */
+  const Value *find(uint64_t id) const {
+    if (size_ == 0) return nullptr;
+    const auto mask = slots_.size() - 1;
+    for (auto i = index(id);; i = (i + 1) & mask) {
+      const auto &slot = slots_[i];
+      if (!slot.occupied) return nullptr;
+      if (slot.id == id) return &slot.value;
+    }
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  struct Slot {
+    uint64_t id = 0;
+    bool occupied = false;
+    Value value{};
+  };
+
+  // fibonacci hashing, spreads sequential ids over the whole table
+  std::size_t index(uint64_t id) const {
+    return (id * 11400714819323198485ull) >> shift_;
+  }
+
+  std::vector<Slot> slots_;
+  unsigned shift_ = 63;
+  std::size_t size_ = 0;
+};
+
+}  // namespace solana
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace solana {
+
+///
+/// Single pass reader over a json text
+///
+/// Used to decode hot rpc responses without building a json DOM. Values are
+/// read in document order, members a caller isn't interested in are skipped.
+/// Strings are returned as views into the text with escape sequences left
+/// untouched, which is fine for keys, base58 and base64.
+class JsonScanner {
+ public:
+  explicit JsonScanner(std::string_view text) : text_(text) {}
+
+  /**
+   * next non-whitespace character, without consuming it
+   */
+  char peek() {
+    skipWhitespace();
+    if (pos_ >= text_.size()) fail("unexpected end");
+    return text_[pos_];
+  }
+
+  /**
+   * consume c if it is the next non-whitespace character
+   */
+  bool consume(char c) {
+    if (peek() != c) return false;
+    pos_++;
+    return true;
+  }
+
+  /**
+   * consume c or throw
+   */
+  void expect(char c) {
+    if (!consume(c)) fail(std::string("expected '") + c + "'");
+  }
+
+  /**
+   * @return contents of the next string, escape sequences are not resolved
+   */
+  std::string_view string() {
+    expect('"');
+    const auto start = pos_;
+    for (;;) {
+      // memchr is much faster than a char by char loop on long base64 data
+      const auto quote = text_.find('"', pos_);
+      if (quote == std::string_view::npos) fail("unterminated string");
+      pos_ = quote + 1;
+      // a quote preceded by an odd number of backslashes is escaped
+      size_t backslashes = 0;
+      while (quote - backslashes > start &&
+             text_[quote - backslashes - 1] == '\\')
+        backslashes++;
+      if (backslashes % 2 == 0) return text_.substr(start, quote - start);
+    }
+  }
+
+  uint64_t unsignedInteger() {
+    peek();
+    const auto start = pos_;
+    uint64_t result = 0;
+    while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+      result = result * 10 + (text_[pos_++] - '0');
+    }
+    if (pos_ == start) fail("expected unsigned integer");
+    return result;
+  }
+
+  bool boolean() {
+    if (literal("true")) return true;
+    if (literal("false")) return false;
+    fail("expected boolean");
+  }
+
+  /**
+   * consume null if it is the next value
+   */
+  bool null() { return literal("null"); }
+
+  /**
+   * read an object, onMember(key) is called for every member and has to
+   * consume its value
+   */
+  template <typename OnMember>
+  void object(OnMember &&onMember) {
+    expect('{');
+    if (consume('}')) return;
+    do {
+      const auto key = string();
+      expect(':');
+      onMember(key);
+    } while (consume(','));
+    expect('}');
+  }
+
+  /**
+   * read an array, onElement() is called for every element and has to consume
+   * it
+   */
+  template <typename OnElement>
+  void array(OnElement &&onElement) {
+    expect('[');
+    if (consume(']')) return;
+    do {
+      onElement();
+    } while (consume(','));
+    expect(']');
+  }
+
+  /**
+   * skip the next value
+   * @return text of the skipped value
+   */
+  std::string_view skipValue() {
+    const auto c = peek();
+    const auto start = pos_;
+    if (c == '"') {
+      string();
+    } else if (c == '{' || c == '[') {
+      size_t depth = 0;
+      do {
+        const auto next = text_[pos_];
+        if (next == '"') {
+          string();
+          continue;
+        }
+        if (next == '{' || next == '[') depth++;
+        if (next == '}' || next == ']') depth--;
+        pos_++;
+      } while (depth > 0 && pos_ < text_.size());
+      if (depth > 0) fail("unexpected end");
+    } else {
+      // number or literal
+      while (pos_ < text_.size() && !isDelimiter(text_[pos_])) pos_++;
+    }
+    return text_.substr(start, pos_ - start);
+  }
+
+ private:
+  static bool isDelimiter(char c) {
+    return c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' ||
+           c == '\r' || c == '\n';
+  }
+
+  void skipWhitespace() {
+    while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t' ||
+                                   text_[pos_] == '\r' || text_[pos_] == '\n'))
+      pos_++;
+  }
+
+  bool literal(std::string_view word) {
+    peek();
+    if (text_.substr(pos_, word.size()) != word) return false;
+    pos_ += word.size();
+    return true;
+  }
+
+  [[noreturn]] void fail(const std::string &what) const {
+    throw std::runtime_error("invalid json, " + what + " at offset " +
+                             std::to_string(pos_));
+  }
+
+  std::string_view text_;
+  size_t pos_ = 0;
+};
+
+}  // namespace solana
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace solana {
+
+///
+/// Value guarded by a sequence counter
+///
+/// Readers never block and never write shared memory: they copy the value and
+/// retry if a write was in progress or happened meanwhile. Only one writer may
+/// store at a time, concurrent writers have to be serialized by the caller.
+/// Suited for small to medium values that are read far more often than they
+/// are written.
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Seqlock values are copied bytewise");
+
+ public:
+  /**
+   * publish value to readers, callers serialize writes
+   */
+  void store(const T &value) {
+    const auto seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&value_, &value, sizeof(T));
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * copy the latest value into out
+   * @return false if nothing was stored yet
+   */
+  bool load(T &out) const {
+    for (;;) {
+      const auto before = seq_.load(std::memory_order_acquire);
+      if (before == 0) return false;
+      if (before & 1) {
+        pause();
+        continue;
+      }
+      std::memcpy(&out, &value_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == before) return true;
+    }
+  }
+
+  /**
+   * number of stores so far
+   */
+  uint64_t version() const {
+    return seq_.load(std::memory_order_acquire) / 2;
+  }
+
+ private:
+  static void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+  }
+
+  std::atomic<uint64_t> seq_{0};
+  T value_{};
+};
+
+}  // namespace solana
@@ -9,15 +9,24 @@
 #include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "base58.hpp"
 #include "base64.hpp"
+#include "conflated.hpp"
+#include "jsonScanner.hpp"
 #include "websocket.hpp"
 
 namespace net = boost::asio;  // from <boost/asio.hpp>
@@ -46,7 +55,20 @@ struct PublicKey {
 
   bool operator==(const PublicKey &other) const;
 
+  bool operator!=(const PublicKey &other) const;
+
+  /**
+   * lexicographic byte order, for ordered containers
+   */
+  bool operator<(const PublicKey &other) const;
+
   std::string toBase58() const;
+
+  /**
+   * write the base58 encoding to out without allocating
+   * @return number of characters written, out is not null-terminated
+   */
+  size_t toBase58(char (&out)[B58_32_MAX_SIZE]) const;
 };
 
 /**
@@ -59,6 +81,86 @@ void to_json(json &j, const PublicKey &key);
  */
 void from_json(const json &j, PublicKey &key);
 
+///
+/// Hashing PublicKeys
+///
+/// Keys are uniformly random bytes already, so the first 8 of them make a
+/// good hash without looking at the rest. The functors are transparent over
+/// PublicKey and its raw array_t, e.g. for keys read straight from account
+/// data.
+struct PublicKeyHash {
+  using is_transparent = void;
+
+  size_t operator()(const PublicKey::array_t &data) const noexcept {
+    size_t hash;
+    memcpy(&hash, data.data(), sizeof(hash));
+    return hash;
+  }
+
+  size_t operator()(const PublicKey &key) const noexcept {
+    return (*this)(key.data);
+  }
+};
+
+struct PublicKeyEqual {
+  using is_transparent = void;
+
+  template <typename A, typename B>
+  bool operator()(const A &a, const B &b) const noexcept {
+    return bytes(a) == bytes(b);
+  }
+
+ private:
+  static const PublicKey::array_t &bytes(const PublicKey &key) {
+    return key.data;
+  }
+  static const PublicKey::array_t &bytes(const PublicKey::array_t &data) {
+    return data;
+  }
+};
+}  // namespace solana
+
+namespace std {
+template <>
+struct hash<solana::PublicKey> : solana::PublicKeyHash {};
+}  // namespace std
+
+namespace solana {
+///
+/// Maps PublicKeys to dense ids
+///
+/// Ids are handed out in order starting at 0, so state keyed by account can
+/// live in flat arrays indexed by id instead of maps. Not thread safe.
+class PublicKeyInterner {
+ public:
+  /**
+   * @return id of key, a new one if key hasn't been seen before
+   */
+  uint32_t intern(const PublicKey &key) {
+    const auto [it, inserted] =
+        ids_.try_emplace(key, static_cast<uint32_t>(keys_.size()));
+    if (inserted) keys_.push_back(key);
+    return it->second;
+  }
+
+  /**
+   * @return id of key if it has been interned
+   */
+  std::optional<uint32_t> find(const PublicKey &key) const {
+    const auto it = ids_.find(key);
+    if (it == ids_.end()) return std::nullopt;
+    return it->second;
+  }
+
+  const PublicKey &key(uint32_t id) const { return keys_.at(id); }
+
+  size_t size() const { return keys_.size(); }
+
+ private:
+  std::unordered_map<PublicKey, uint32_t, PublicKeyHash, PublicKeyEqual> ids_;
+  std::vector<PublicKey> keys_;
+};
+
 struct PrivateKey {
   static const size_t SIZE = crypto_sign_SECRETKEYBYTES;
   typedef std::array<uint8_t, SIZE> array_t;
@@ -380,6 +482,45 @@ struct LargestAccountsConfig {
 };
 void to_json(json &j, const LargestAccountsConfig &config);
 
+/**
+ * Compares the bytes of an account's data at offset
+ */
+struct MemcmpFilter {
+  uint64_t offset;
+  /** base58 encoded bytes to match */
+  std::string bytes;
+};
+
+/**
+ * Filters of a program subscription, accounts have to pass all of them
+ */
+struct ProgramAccountFilters {
+  /** only accounts with this size of data */
+  std::optional<uint64_t> dataSize = std::nullopt;
+  std::vector<MemcmpFilter> memcmp;
+};
+
+/**
+ * ProgramAccountFilters to the json array of filters
+ */
+void to_json(json &j, const ProgramAccountFilters &filters);
+
+/**
+ * Transactions a logs subscription is sent logs of
+ */
+enum class LogsFilter : short {
+  /** all transactions except simple vote transactions */
+  ALL,
+  /** all transactions including simple vote transactions */
+  ALL_WITH_VOTES,
+};
+
+NLOHMANN_JSON_SERIALIZE_ENUM(LogsFilter,
+                             {
+                                 {LogsFilter::ALL, "all"},
+                                 {LogsFilter::ALL_WITH_VOTES, "allWithVotes"},
+                             })
+
 struct SignatureStatus {
   /** when the transaction was processed */
   uint64_t slot;
@@ -620,6 +761,272 @@ void from_json(const json &j, std::optional<AccountInfo<T>> &info) {
   }
 }
 
+/**
+ * Decode an account object straight from the response text into info,
+ * the base64 data is decoded into info.data without intermediate copies
+ */
+template <typename T>
+void decodeAccountInfo(JsonScanner &scanner, AccountInfo<T> &info) {
+  scanner.object([&](std::string_view key) {
+    if (key == "data") {
+      scanner.expect('[');
+      const auto encoded = scanner.string();
+      scanner.expect(',');
+      const auto encoding = scanner.string();
+      scanner.expect(']');
+      // check
+      assert(encoding == BASE64);
+      // decoded data should fit into T
+      const auto size = b64decodedSize(encoded.data(), encoded.size());
+      if (size != sizeof(T))
+        throw std::runtime_error("invalid response length " +
+                                 std::to_string(size) + " expected " +
+                                 std::to_string(sizeof(T)));
+      b64decode(encoded.data(), encoded.size(), &info.data);
+    } else if (key == "executable") {
+      info.executable = scanner.boolean();
+    } else if (key == "owner") {
+      info.owner = PublicKey::fromBase58(std::string(scanner.string()));
+    } else if (key == "lamports") {
+      info.lamports = scanner.unsignedInteger();
+    } else if (key == "rentEpoch") {
+      info.rentEpoch = scanner.unsignedInteger();
+    } else {
+      scanner.skipValue();
+    }
+  });
+}
+
+/**
+ * Decode a nullable account object
+ */
+template <typename T>
+void decodeAccountInfo(JsonScanner &scanner,
+                       std::optional<AccountInfo<T>> &info) {
+  if (scanner.null()) {
+    info = std::nullopt;
+  } else {
+    decodeAccountInfo(scanner, info.emplace());
+  }
+}
+
+/**
+ * Decode a result object with a context and a value, the value is read by
+ * decodeValue(scanner, value)
+ */
+template <typename T, typename DecodeValue>
+void decodeResult(JsonScanner &scanner, Context &context, T &value,
+                  DecodeValue &decodeValue) {
+  scanner.object([&](std::string_view key) {
+    if (key == "context") {
+      scanner.object([&](std::string_view key) {
+        if (key == "slot") {
+          context.slot = scanner.unsignedInteger();
+        } else {
+          scanner.skipValue();
+        }
+      });
+    } else if (key == "value") {
+      decodeValue(scanner, value);
+    } else {
+      scanner.skipValue();
+    }
+  });
+}
+
+/**
+ * Decode the body of a json rpc response whose result has a context, the
+ * value is read by decodeValue(scanner, value)
+ */
+template <typename T, typename DecodeValue>
+RpcResponseAndContext<T> decodeResponse(std::string_view body,
+                                        DecodeValue decodeValue) {
+  RpcResponseAndContext<T> res{};
+  bool hasResult = false;
+  JsonScanner scanner(body);
+  scanner.object([&](std::string_view key) {
+    if (key == "result") {
+      hasResult = true;
+      decodeResult(scanner, res.context, res.value, decodeValue);
+    } else if (key == "error") {
+      throw std::runtime_error(json::parse(scanner.skipValue()).dump());
+    } else {
+      scanner.skipValue();
+    }
+  });
+  if (!hasResult) throw std::runtime_error("missing result in response");
+  return res;
+}
+
+/**
+ * Find the result of a subscription notification and read it with
+ * decodeResult(scanner)
+ */
+template <typename DecodeResult>
+void decodeNotificationResult(std::string_view body,
+                              DecodeResult decodeResult) {
+  bool hasResult = false;
+  JsonScanner scanner(body);
+  scanner.object([&](std::string_view key) {
+    if (key != "params") {
+      scanner.skipValue();
+      return;
+    }
+    scanner.object([&](std::string_view key) {
+      if (key == "result") {
+        hasResult = true;
+        decodeResult(scanner);
+      } else {
+        scanner.skipValue();
+      }
+    });
+  });
+  if (!hasResult) throw std::runtime_error("missing result in notification");
+}
+
+/**
+ * Decode a subscription notification whose result has a context straight
+ * into value, which can be reused across notifications
+ * @return context slot of the notification
+ */
+template <typename T, typename DecodeValue>
+uint64_t decodeNotification(std::string_view body, T &value,
+                            DecodeValue decodeValue) {
+  Context context{};
+  decodeNotificationResult(body, [&](JsonScanner &scanner) {
+    decodeResult(scanner, context, value, decodeValue);
+  });
+  return context.slot;
+}
+
+/**
+ * Decode a getAccountInfo response body into its AccountInfo
+ */
+template <typename T>
+RpcResponseAndContext<std::optional<AccountInfo<T>>> decodeAccountInfoResponse(
+    std::string_view body) {
+  return decodeResponse<std::optional<AccountInfo<T>>>(
+      body, [](JsonScanner &scanner, std::optional<AccountInfo<T>> &info) {
+        decodeAccountInfo(scanner, info);
+      });
+}
+
+/**
+ * Decode a getMultipleAccounts response body into its AccountInfos
+ */
+template <typename T>
+RpcResponseAndContext<std::vector<std::optional<AccountInfo<T>>>>
+decodeMultipleAccountsInfoResponse(std::string_view body) {
+  return decodeResponse<std::vector<std::optional<AccountInfo<T>>>>(
+      body, [](JsonScanner &scanner,
+               std::vector<std::optional<AccountInfo<T>>> &infos) {
+        scanner.array(
+            [&]() { decodeAccountInfo(scanner, infos.emplace_back()); });
+      });
+}
+
+/**
+ * Decode an accountNotification body into info
+ * @return context slot of the notification
+ */
+template <typename T>
+uint64_t decodeAccountNotification(std::string_view body,
+                                   AccountInfo<T> &info) {
+  return decodeNotification(
+      body, info, [](JsonScanner &scanner, AccountInfo<T> &info) {
+        decodeAccountInfo(scanner, info);
+      });
+}
+
+/**
+ * A slot the validator processed, sent by slotSubscribe
+ */
+struct SlotInfo {
+  uint64_t parent;
+  uint64_t root;
+  uint64_t slot;
+};
+
+/**
+ * Outcome of a transaction, sent by signatureSubscribe
+ */
+struct SignatureResult {
+  /** json text of the transaction error, nullopt if it succeeded */
+  std::optional<std::string> err = std::nullopt;
+};
+
+/**
+ * An account owned by a program, sent by programSubscribe
+ */
+template <typename T>
+struct ProgramAccount {
+  PublicKey pubkey;
+  AccountInfo<T> account;
+};
+
+/**
+ * Logs of a transaction, sent by logsSubscribe
+ */
+struct Logs {
+  std::string signature;
+  /** json text of the transaction error, nullopt if it succeeded */
+  std::optional<std::string> err = std::nullopt;
+  std::vector<std::string> logs;
+};
+
+/**
+ * Decode a transaction error, null if there is none
+ */
+void decodeTransactionError(JsonScanner &scanner,
+                            std::optional<std::string> &err);
+
+/**
+ * Decode a slotNotification body into info
+ */
+void decodeSlotNotification(std::string_view body, SlotInfo &info);
+
+/**
+ * Decode a signatureNotification body into result
+ * @return context slot of the notification
+ */
+uint64_t decodeSignatureNotification(std::string_view body,
+                                     SignatureResult &result);
+
+/**
+ * Decode a programNotification body into account, the account data is
+ * decoded like in decodeAccountNotification
+ * @return context slot of the notification
+ */
+template <typename T>
+uint64_t decodeProgramNotification(std::string_view body,
+                                   ProgramAccount<T> &account) {
+  return decodeNotification(
+      body, account, [](JsonScanner &scanner, ProgramAccount<T> &account) {
+        scanner.object([&](std::string_view key) {
+          if (key == "pubkey") {
+            account.pubkey =
+                PublicKey::fromBase58(std::string(scanner.string()));
+          } else if (key == "account") {
+            decodeAccountInfo(scanner, account.account);
+          } else {
+            scanner.skipValue();
+          }
+        });
+      });
+}
+
+/**
+ * Decode a logsNotification body into logs
+ * @return context slot of the notification
+ */
+uint64_t decodeLogsNotification(std::string_view body, Logs &logs);
+
+/**
+ * Decode a rootNotification body
+ * @return the new root slot
+ */
+uint64_t decodeRootNotification(std::string_view body);
+
 /**
  * An instruction to execute by a program
  */
@@ -665,7 +1072,12 @@ const std::string JSON_PARSED = "jsonParsed";
 
 using json = nlohmann::json;
 
-json jsonRequest(const std::string &method, const json &params = nullptr);
+/**
+ * create a json rpc request
+ * @param id identifies the response of this request within a batch
+ */
+json jsonRequest(const std::string &method, const json &params = nullptr,
+                 uint64_t id = 1);
 
 /**
  * Read AccountInfo dumped in a file
@@ -775,6 +1187,126 @@ struct GetAccountInfoConfig {
  */
 void to_json(json &j, const GetAccountInfoConfig &config);
 
+/**
+ * Default number of idle HTTP sessions kept alive per Connection
+ */
+const size_t DEFAULT_SESSION_POOL_SIZE = 8;
+
+/**
+ * Most keys the rpc nodes accept in a single getMultipleAccounts request
+ */
+const size_t MAX_MULTIPLE_ACCOUNTS = 100;
+
+///
+/// Pool of reusable HTTP sessions to a single rpc url
+///
+/// Every session owns a curl handle, which keeps its TCP (and TLS) connection
+/// to the rpc node alive between requests. Sessions are checked out by one
+/// caller at a time, so concurrent callers never share a handle.
+class SessionPool {
+ public:
+  /**
+   * Session checked out of the pool, returned to it on destruction
+   */
+  class Lease {
+   public:
+    Lease(SessionPool &pool, std::unique_ptr<cpr::Session> session);
+    Lease(Lease &&other) noexcept = default;
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+    ~Lease();
+
+    cpr::Session &operator*() const { return *session_; }
+    cpr::Session *operator->() const { return session_.get(); }
+
+   private:
+    SessionPool *pool_;
+    std::unique_ptr<cpr::Session> session_;
+  };
+
+  /**
+   * @param url the rpc url every session of this pool posts to
+   * @param size maximum number of idle sessions kept alive, more sessions are
+   * created on demand but closed once they are returned to a full pool
+   */
+  SessionPool(const std::string &url, size_t size);
+
+  /**
+   * Check out an idle session, or create a new one if none is available
+   */
+  Lease checkout();
+
+  /**
+   * Maximum number of idle sessions kept alive
+   */
+  size_t size() const { return size_; }
+
+  /**
+   * Number of sessions currently idle in the pool
+   */
+  size_t idle() const;
+
+ private:
+  void checkin(std::unique_ptr<cpr::Session> session);
+
+  const std::string url_;
+  const size_t size_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<cpr::Session>> idle_;
+};
+
+/**
+ * Completion handler of an asynchronous rpc request. Called with the exception
+ * that failed the request, or with a null exception and the request's result.
+ */
+using ResponseHandler = std::function<void(std::exception_ptr, json)>;
+
+/**
+ * ResponseHandler fulfilling promise with the result converted by parse,
+ * exceptions thrown by parse are forwarded to the promise as well
+ */
+template <typename T, typename Parse>
+ResponseHandler fulfill(std::shared_ptr<std::promise<T>> promise,
+                        Parse parse) {
+  return [promise, parse](std::exception_ptr error, json res) {
+    if (error) return promise->set_exception(error);
+    try {
+      promise->set_value(parse(res));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  };
+}
+
+/**
+ * AccountInfo from the result of getAccountInfo
+ */
+template <typename T>
+RpcResponseAndContext<std::optional<AccountInfo<T>>> accountInfoFromResult(
+    const json &res) {
+  const json value = res["value"];
+  if (value.is_null()) {
+    return {res["context"], std::nullopt};
+  } else {
+    return {res["context"], std::optional<AccountInfo<T>>{value}};
+  }
+}
+
+/**
+ * AccountInfos from the result of getMultipleAccounts
+ */
+template <typename T>
+RpcResponseAndContext<std::vector<std::optional<AccountInfo<T>>>>
+multipleAccountsInfoFromResult(const json &res) {
+  return {res["context"], res["value"]};
+}
+
+/**
+ * Event loop sending the asynchronous requests of a Connection, defined in
+ * solana.cpp
+ */
+class RequestLoop;
+
 ///
 /// RPC HTTP Endpoints
 class Connection {
@@ -782,14 +1314,43 @@ class Connection {
   /**
    * Initialize the rpc url and commitment levels to use.
    * Initialize sodium
+   * @param session_pool_size number of keep-alive HTTP sessions to reuse
+   * across requests
    */
-  Connection(const std::string &rpc_url = MAINNET_BETA);
+  Connection(const std::string &rpc_url = MAINNET_BETA,
+             size_t session_pool_size = DEFAULT_SESSION_POOL_SIZE);
   /*
    * send rpc request
    * @return result from response
    */
   json sendJsonRpcRequest(const json &body) const;
 
+  /**
+   * send rpc request
+   * @return body of the response, for callers decoding it themselves
+   */
+  std::string sendRawJsonRpcRequest(const json &body) const;
+
+  /**
+   * send a batch of rpc requests in a single round trip
+   * @return array of responses, in any order, matched to the requests by id
+   */
+  json sendJsonRpcBatch(const json &requests) const;
+
+  /**
+   * send rpc request without blocking the calling thread.
+   * The handler is invoked on the connection's request thread, it should not
+   * block as it delays all other in-flight requests of this connection.
+   */
+  void sendJsonRpcRequestAsync(const json &body,
+                               ResponseHandler handler) const;
+
+  /**
+   * send rpc request without blocking the calling thread
+   * @return future result from response
+   */
+  std::future<json> sendJsonRpcRequestAsync(const json &body) const;
+
   /**
    * @deprecated
    * Sign and send a transaction
@@ -1067,14 +1628,8 @@ class Connection {
     // create request
     const json params = {publicKey, config};
     const json reqJson = jsonRequest("getAccountInfo", params);
-    // send jsonRpc request
-    const json res = sendJsonRpcRequest(reqJson);
-    const json value = res["value"];
-    if (value.is_null()) {
-      return {res["context"], std::nullopt};
-    } else {
-      return {res["context"], std::optional<AccountInfo<T>>{value}};
-    }
+    // send jsonRpc request and decode the account straight from the body
+    return decodeAccountInfoResponse<T>(sendRawJsonRpcRequest(reqJson));
   }
 
   /**
@@ -1089,14 +1644,296 @@ class Connection {
     // create request
     const json params = {publicKeys, config};
     const json reqJson = jsonRequest("getMultipleAccounts", params);
-    // send jsonRpc request
-    const json res = sendJsonRpcRequest(reqJson);
+    // send jsonRpc request and decode the accounts straight from the body
+    return decodeMultipleAccountsInfoResponse<T>(
+        sendRawJsonRpcRequest(reqJson));
+  }
+
+  /**
+   * Asynchronous counterparts of the methods above. They only build and queue
+   * the request, the future becomes ready once the response arrived.
+   */
+
+  std::future<std::string> sendTransactionAsync(
+      const Keypair &keypair, const CompiledTransaction &tx,
+      const SendTransactionConfig &config = SendTransactionConfig()) const;
+
+  std::future<std::string> sendRawTransactionAsync(
+      const std::vector<uint8_t> &tx,
+      const SendTransactionConfig &config = SendTransactionConfig()) const;
+
+  std::future<std::string> sendEncodedTransactionAsync(
+      const std::string &transaction,
+      const SendTransactionConfig &config = SendTransactionConfig()) const;
+
+  std::future<SimulatedTransactionResponse> simulateTransactionAsync(
+      const Keypair &keypair, const CompiledTransaction &tx,
+      const SimulateTransactionConfig &config =
+          SimulateTransactionConfig()) const;
+
+  std::future<std::string> requestAirdropAsync(const PublicKey &pubkey,
+                                               uint64_t lamports) const;
+
+  std::future<uint64_t> getBalanceAsync(const PublicKey &pubkey) const;
+
+  std::future<Blockhash> getLatestBlockhashAsync(
+      const Commitment &commitment = Commitment::FINALIZED) const;
+
+  std::future<uint64_t> getBlockHeightAsync(
+      const Commitment &commitment = Commitment::FINALIZED) const;
+
+  /**
+   * Poll the signature status like confirmTransaction, waiting between
+   * retries on the request thread instead of the calling thread
+   */
+  std::future<bool> confirmTransactionAsync(std::string transactionSignature,
+                                            Commitment confirmLevel,
+                                            uint16_t retries = 200) const;
+
+  std::future<
+      RpcResponseAndContext<std::vector<std::optional<SignatureStatus>>>>
+  getSignatureStatusesAsync(const std::vector<std::string> &signatures,
+                            bool searchTransactionHistory = false) const;
+
+  std::future<Version> getVersionAsync() const;
+
+  std::future<uint64_t> minimumLedgerSlotAsync() const;
+
+  std::future<std::string> getGenesisHashAsync() const;
+
+  std::future<EpochSchedule> getEpochScheduleAsync() const;
+
+  std::future<uint64_t> getSlotAsync(
+      const GetSlotConfig &config = GetSlotConfig{}) const;
+
+  std::future<std::string> getSlotLeaderAsync(
+      const GetSlotConfig &config = GetSlotConfig{}) const;
+
+  std::future<uint64_t> getFirstAvailableBlockAsync() const;
+
+  std::future<StakeActivation> getStakeActivationAsync(
+      const PublicKey &pubkey, const GetStakeActivationConfig &config =
+                                   GetStakeActivationConfig{}) const;
+
+  std::future<InflationGovernor> getInflationGovernorAsync(
+      const commitmentconfig &config = commitmentconfig{}) const;
+
+  std::future<uint64_t> getTransactionCountAsync(
+      const GetSlotConfig &config = GetSlotConfig{}) const;
+
+  std::future<EpochInfo> getEpochInfoAsync(
+      const GetSlotConfig &config = GetSlotConfig{}) const;
+
+  std::future<uint64_t> getMinimumBalanceForRentExemptionAsync(
+      const std::size_t dataLength,
+      const commitmentconfig &config = commitmentconfig{}) const;
+
+  std::future<uint64_t> getBlockTimeAsync(const uint64_t slot) const;
+
+  std::future<std::vector<Nodes>> getClusterNodesAsync() const;
+
+  std::future<getFeeForMessageRes> getFeeForMessageAsync(
+      const std::string message,
+      const GetSlotConfig &config = GetSlotConfig{}) const;
+
+  std::future<std::vector<RecentPerformanceSamples>>
+  getRecentPerformanceSamplesAsync(std::size_t limit) const;
+
+  std::future<RpcResponseAndContext<std::vector<LargestAccounts>>>
+  getLargestAccountsAsync(
+      const LargestAccountsConfig &config = LargestAccountsConfig{}) const;
+
+  std::future<RpcResponseAndContext<std::optional<SignatureStatus>>>
+  getSignatureStatusAsync(const std::string &signature,
+                          bool searchTransactionHistory = false) const;
+
+  std::future<std::vector<std::string>> getSlotLeadersAsync(
+      uint64_t startSlot, uint64_t limit) const;
+
+  std::future<RpcResponseAndContext<Supply>> getSupplyAsync(
+      const GetSupplyConfig &config = GetSupplyConfig{}) const;
+
+  std::future<RpcResponseAndContext<TokenAccountBalance>>
+  getTokenAccountBalanceAsync(
+      const std::string pubkey,
+      const commitmentconfig &config = commitmentconfig{}) const;
+
+  std::future<VoteAccounts> getVoteAccountsAsync(
+      const GetVoteAccountsConfig &config = GetVoteAccountsConfig{}) const;
+
+  std::future<std::vector<SignaturesAddress>> getSignaturesForAddressAsync(
+      std::string pubkey, const GetSignatureAddressConfig &config =
+                              GetSignatureAddressConfig{}) const;
+
+  std::future<RpcResponseAndContext<std::vector<TokenLargestAccounts>>>
+  getTokenLargestAccountsAsync(
+      std::string pubkey,
+      const commitmentconfig &config = commitmentconfig{}) const;
+
+  std::future<std::vector<uint64_t>> getBlocksAsync(
+      uint64_t start_slot, uint64_t end_slot,
+      const commitmentconfig &config = commitmentconfig{}) const;
+
+  std::future<TokenSupply> getTokenSupplyAsync(std::string pubKey) const;
+
+  std::future<BlockProduction> getBlockProductionAsync(
+      const BlockProductionConfig &config = BlockProductionConfig{}) const;
+
+  std::future<std::vector<std::pair<std::string, std::vector<uint64_t>>>>
+  getLeaderScheduleAsync(const std::optional<uint64_t> slot,
+                         const GetSlotConfig &config) const;
+
+  std::future<RpcResponseAndContext<std::vector<TokenAccountsByOwner>>>
+  getTokenAccountsByOwnerAsync(std::string pubkey,
+                               const mintOrProgramIdConfig &mPconfig,
+                               const TokenAccountsByOwnerConfig &config) const;
+
+  template <typename T>
+  std::future<RpcResponseAndContext<std::optional<AccountInfo<T>>>>
+  getAccountInfoAsync(
+      const PublicKey &publicKey,
+      const GetAccountInfoConfig &config = GetAccountInfoConfig{}) const {
+    // create request
+    const json params = {publicKey, config};
+    const json reqJson = jsonRequest("getAccountInfo", params);
+    // queue jsonRpc request
+    return sendAsync<RpcResponseAndContext<std::optional<AccountInfo<T>>>>(
+        reqJson, accountInfoFromResult<T>);
+  }
+
+  template <typename T>
+  std::future<RpcResponseAndContext<std::vector<std::optional<AccountInfo<T>>>>>
+  getMultipleAccountsInfoAsync(
+      const std::vector<PublicKey> &publicKeys,
+      const GetAccountInfoConfig &config = GetAccountInfoConfig{}) const {
+    // create request
+    const json params = {publicKeys, config};
+    const json reqJson = jsonRequest("getMultipleAccounts", params);
+    // queue jsonRpc request
+    return sendAsync<
+        RpcResponseAndContext<std::vector<std::optional<AccountInfo<T>>>>>(
+        reqJson, multipleAccountsInfoFromResult<T>);
+  }
+
+ private:
+  /**
+   * post a json body using one of the pooled sessions
+   */
+  cpr::Response post(const json &body) const;
+
+  /**
+   * queue a request and convert its result with parse once it arrived,
+   * exceptions thrown by parse are forwarded to the returned future
+   */
+  template <typename T, typename Parse>
+  std::future<T> sendAsync(const json &reqJson, Parse parse) const {
+    auto promise = std::make_shared<std::promise<T>>();
+    auto future = promise->get_future();
+    sendJsonRpcRequestAsync(reqJson, fulfill(promise, parse));
+    return future;
+  }
+
+  /**
+   * queue a request whose result converts to T directly
+   */
+  template <typename T>
+  std::future<T> sendAsync(const json &reqJson) const {
+    return sendAsync<T>(reqJson,
+                        [](const json &res) { return res.get<T>(); });
+  }
+
+  const std::string rpc_url_;
+  // shared so that copies of a Connection reuse the same warm sessions
+  std::shared_ptr<SessionPool> sessions_;
+  // started on the first asynchronous request, shared by copies as well
+  std::shared_ptr<RequestLoop> requests_;
+};
 
-    return {res["context"], res["value"]};
+///
+/// JSON-RPC 2.0 batch of requests
+///
+/// Requests are queued by the methods below and sent as one json array in a
+/// single round trip by send(). Every result is routed back to the future
+/// returned when its request was queued.
+class BatchRequest {
+ public:
+  explicit BatchRequest(const Connection &connection);
+
+  /**
+   * queue a request, its result is converted with parse
+   */
+  template <typename T, typename Parse>
+  std::future<T> add(const std::string &method, const json &params,
+                     Parse parse) {
+    auto promise = std::make_shared<std::promise<T>>();
+    auto future = promise->get_future();
+    requests_.push_back(jsonRequest(method, params, handlers_.size()));
+    handlers_.push_back(fulfill(promise, parse));
+    return future;
+  }
+
+  /**
+   * queue a request whose result converts to T directly
+   */
+  template <typename T = json>
+  std::future<T> add(const std::string &method, const json &params = nullptr) {
+    return add<T>(method, params,
+                  [](const json &res) { return res.get<T>(); });
   }
 
+  std::future<Blockhash> getLatestBlockhash(
+      const Commitment &commitment = Commitment::FINALIZED);
+
+  std::future<uint64_t> getBlockHeight(
+      const Commitment &commitment = Commitment::FINALIZED);
+
+  std::future<uint64_t> getSlot(const GetSlotConfig &config = GetSlotConfig{});
+
+  std::future<uint64_t> getBalance(const PublicKey &pubkey);
+
+  std::future<
+      RpcResponseAndContext<std::vector<std::optional<SignatureStatus>>>>
+  getSignatureStatuses(const std::vector<std::string> &signatures,
+                       bool searchTransactionHistory = false);
+
+  template <typename T>
+  std::future<RpcResponseAndContext<std::optional<AccountInfo<T>>>>
+  getAccountInfo(const PublicKey &publicKey,
+                 const GetAccountInfoConfig &config = GetAccountInfoConfig{}) {
+    const json params = {publicKey, config};
+    return add<RpcResponseAndContext<std::optional<AccountInfo<T>>>>(
+        "getAccountInfo", params, accountInfoFromResult<T>);
+  }
+
+  template <typename T>
+  std::future<RpcResponseAndContext<std::vector<std::optional<AccountInfo<T>>>>>
+  getMultipleAccountsInfo(
+      const std::vector<PublicKey> &publicKeys,
+      const GetAccountInfoConfig &config = GetAccountInfoConfig{}) {
+    const json params = {publicKeys, config};
+    return add<
+        RpcResponseAndContext<std::vector<std::optional<AccountInfo<T>>>>>(
+        "getMultipleAccounts", params, multipleAccountsInfoFromResult<T>);
+  }
+
+  /**
+   * Number of queued requests
+   */
+  size_t size() const { return requests_.size(); }
+
+  /**
+   * send all queued requests in one round trip and fulfill their futures.
+   * Errors of single requests are only forwarded to their future, if the
+   * whole batch fails all futures receive the error and it is rethrown.
+   * The batch is empty afterwards and can be reused.
+   */
+  void send();
+
  private:
-  const std::string &rpc_url_;
+  const Connection connection_;
+  json requests_ = json::array();
+  // indexed by request id
+  std::vector<ResponseHandler> handlers_;
 };
 
 ///
@@ -1112,18 +1949,62 @@ json accountSubscribeRequest(
     const Commitment commitment = Commitment::FINALIZED,
     const std::string &encoding = BASE64);
 
+/**
+ * Parts of a ws:// or wss:// url
+ */
+struct WebSocketUrl {
+  bool tls;
+  std::string host;
+  std::string port;
+  std::string target;
+};
+
+/**
+ * Split a websocket url, the port defaults to 80 for ws:// and 443 for wss://
+ * and the target to /
+ */
+WebSocketUrl parseWebSocketUrl(const std::string &url);
+
 class WebSocketSubscriber {
  public:
   net::io_context ioc;
   std::shared_ptr<session> sess;
   std::thread read_thread;
-  RequestIdType curr_id = 0;
+  std::atomic<RequestIdType> curr_id{0};
   std::vector<std::string> available_commitment;
 
+  /// @brief connect to host, reconnecting with backoff whenever the
+  /// connection drops. Subscriptions are replayed on every new connection
+  /// @param dispatch_options callbacks run on the io thread by default, with
+  /// dispatch_options.workers > 0 on a pool of workers. Callbacks of one
+  /// subscription always run in order
   WebSocketSubscriber(const std::string &host, const std::string &port,
-                      int timeout_in_seconds = 30);
+                      int timeout_in_seconds = 30,
+                      ReconnectPolicy reconnect_policy = {},
+                      DispatchOptions dispatch_options = {});
+  /// @brief connect to a ws:// or wss:// url, e.g.
+  /// wss://api.mainnet-beta.solana.com
+  /// @param ssl_context tls context for wss://, can be shared between
+  /// subscribers. Defaults to default_ssl_context()
+  explicit WebSocketSubscriber(const std::string &url,
+                               int timeout_in_seconds = 30,
+                               ReconnectPolicy reconnect_policy = {},
+                               std::shared_ptr<ssl::context> ssl_context =
+                                   nullptr,
+                               DispatchOptions dispatch_options = {});
   ~WebSocketSubscriber();
 
+  /// @brief callback to call for every subscription restored after a
+  /// reconnect, with the slot of its last notification before the drop
+  /// @param on_gap callback to call
+  void onGap(GapCallback on_gap);
+
+  /// @brief counters of the dispatch pool, all zero without workers
+  DispatchStats dispatchStats() const;
+
+  /// @brief connection state and counters of the session
+  SessionHealth health() const;
+
   /// @brief callback to call when data in account changes
   /// @param pub_key public key for the account
   /// @param account_change_callback callback to call when the data changes
@@ -1135,9 +2016,268 @@ class WebSocketSubscriber {
                       Callback on_subscibe = nullptr,
                       Callback on_unsubscribe = nullptr);
 
+  /// @brief callback to call with the decoded account when it changes
+  ///
+  /// Only the notification header is parsed as json, the account data is
+  /// base64 decoded straight into one AccountInfo<T> that is reused for all
+  /// notifications of this subscription. It is only valid during the callback.
+  /// @param pub_key public key for the account
+  /// @param account_change_callback callback to call with the account and the
+  /// slot of the notification
+  /// @param commitment commitment
+  /// @return subsccription id (actually the current id)
+  template <typename T>
+  int onAccountChange(
+      const solana::PublicKey &pub_key,
+      std::function<void(const AccountInfo<T> &, uint64_t)>
+          account_change_callback,
+      const Commitment &commitment = Commitment::FINALIZED,
+      Callback on_subscibe = nullptr, Callback on_unsubscribe = nullptr) {
+    auto info = std::make_shared<AccountInfo<T>>();
+    RawCallback raw_cb = [info, cb = std::move(account_change_callback)](
+                             std::string_view notification) {
+      const auto slot = decodeAccountNotification(notification, *info);
+      cb(*info, slot);
+    };
+    return subscribe("accountSubscribe", "accountUnsubscribe",
+                     accountSubscribeParams(pub_key, commitment), nullptr,
+                     std::move(raw_cb), on_subscibe, on_unsubscribe);
+  }
+
+  /// @brief keep only the latest state of an account in latest
+  ///
+  /// Notifications are decoded into a spare buffer that is swapped into
+  /// latest, unless latest holds a later slot already. Consumers take or wait
+  /// for the newest state from any thread and skip the states they fell
+  /// behind on, Conflated::counters tells how many.
+  /// @param pub_key public key for the account
+  /// @param latest receives the account and the slot of the notification
+  /// @param commitment commitment
+  /// @return subsccription id (actually the current id)
+  template <typename T>
+  int onAccountChange(const solana::PublicKey &pub_key,
+                      std::shared_ptr<Conflated<AccountInfo<T>>> latest,
+                      const Commitment &commitment = Commitment::FINALIZED,
+                      Callback on_subscibe = nullptr,
+                      Callback on_unsubscribe = nullptr) {
+    auto spare = std::make_shared<std::unique_ptr<AccountInfo<T>>>(
+        std::make_unique<AccountInfo<T>>());
+    RawCallback raw_cb = [latest = std::move(latest),
+                          spare](std::string_view notification) {
+      const auto slot = decodeAccountNotification(notification, **spare);
+      latest->publish(*spare, slot);
+    };
+    return subscribe("accountSubscribe", "accountUnsubscribe",
+                     accountSubscribeParams(pub_key, commitment), nullptr,
+                     std::move(raw_cb), on_subscibe, on_unsubscribe);
+  }
+
+  /// @brief callback to call for every slot the validator processed
+  /// @param slot_change_callback callback to call with the slot
+  /// @return subsccription id (actually the current id)
+  int onSlotChange(std::function<void(const SlotInfo &)> slot_change_callback,
+                   Callback on_subscibe = nullptr,
+                   Callback on_unsubscribe = nullptr);
+
+  /// @brief callback to call once the transaction reached commitment, the
+  /// server ends the subscription after that
+  /// @param signature base58 encoded transaction signature
+  /// @param signature_callback callback to call with the outcome and the slot
+  /// of the notification
+  /// @param commitment commitment
+  /// @return subsccription id (actually the current id)
+  int onSignature(
+      const std::string &signature,
+      std::function<void(const SignatureResult &, uint64_t)>
+          signature_callback,
+      const Commitment &commitment = Commitment::FINALIZED,
+      Callback on_subscibe = nullptr, Callback on_unsubscribe = nullptr);
+
+  /// @brief callback to call with the decoded account whenever an account
+  /// owned by program_id changes
+  ///
+  /// Accounts are decoded like in the typed onAccountChange, into one
+  /// ProgramAccount<T> reused for all notifications. Without a dataSize
+  /// filter, only accounts of sizeof(T) are sent.
+  /// @param program_id public key of the program
+  /// @param program_account_callback callback to call with the account and
+  /// the slot of the notification
+  /// @param filters filters accounts have to pass
+  /// @param commitment commitment
+  /// @return subsccription id (actually the current id)
+  template <typename T>
+  int onProgramAccountChange(
+      const solana::PublicKey &program_id,
+      std::function<void(const ProgramAccount<T> &, uint64_t)>
+          program_account_callback,
+      ProgramAccountFilters filters = {},
+      const Commitment &commitment = Commitment::FINALIZED,
+      Callback on_subscibe = nullptr, Callback on_unsubscribe = nullptr) {
+    if (!filters.dataSize.has_value()) filters.dataSize = sizeof(T);
+    auto account = std::make_shared<ProgramAccount<T>>();
+    RawCallback raw_cb = [account, cb = std::move(program_account_callback)](
+                             std::string_view notification) {
+      const auto slot = decodeProgramNotification(notification, *account);
+      cb(*account, slot);
+    };
+    return subscribe("programSubscribe", "programUnsubscribe",
+                     programSubscribeParams(program_id, filters, commitment),
+                     nullptr, std::move(raw_cb), on_subscibe, on_unsubscribe);
+  }
+
+  /// @brief callback to call with the logs of every transaction mentioning
+  /// an account
+  /// @param mentions public key the transactions mention
+  /// @param logs_callback callback to call with the logs and the slot of the
+  /// notification
+  /// @param commitment commitment
+  /// @return subsccription id (actually the current id)
+  int onLogs(const solana::PublicKey &mentions,
+             std::function<void(const Logs &, uint64_t)> logs_callback,
+             const Commitment &commitment = Commitment::FINALIZED,
+             Callback on_subscibe = nullptr, Callback on_unsubscribe = nullptr);
+
+  /// @brief callback to call with the logs of every transaction
+  /// @param filter whether vote transactions are included
+  /// @param logs_callback callback to call with the logs and the slot of the
+  /// notification
+  /// @param commitment commitment
+  /// @return subsccription id (actually the current id)
+  int onLogs(LogsFilter filter,
+             std::function<void(const Logs &, uint64_t)> logs_callback,
+             const Commitment &commitment = Commitment::FINALIZED,
+             Callback on_subscibe = nullptr, Callback on_unsubscribe = nullptr);
+
+  /// @brief callback to call whenever the validator sets a new root
+  /// @param root_change_callback callback to call with the root slot
+  /// @return subsccription id (actually the current id)
+  int onRootChange(std::function<void(uint64_t)> root_change_callback,
+                   Callback on_subscibe = nullptr,
+                   Callback on_unsubscribe = nullptr);
+
   /// @brief remove the account change listener for the given id
   /// @param sub_id the id for which removing subscription is needed
   void removeAccountChangeListener(RequestIdType sub_id);
+
+  /// @brief remove any listener, works for the ids of all on* methods
+  /// @param sub_id the id for which removing subscription is needed
+  void removeListener(RequestIdType sub_id);
+
+ private:
+  /// @brief start the io thread and wait for the first handshake
+  void connect(const WebSocketUrl &url, int timeout_in_seconds,
+               ReconnectPolicy reconnect_policy,
+               std::shared_ptr<ssl::context> ssl_context,
+               DispatchOptions dispatch_options);
+
+  /// @brief params of an accountSubscribe request
+  static json accountSubscribeParams(const solana::PublicKey &pub_key,
+                                     const Commitment &commitment);
+
+  /// @brief params of a programSubscribe request
+  static json programSubscribeParams(const solana::PublicKey &program_id,
+                                     const ProgramAccountFilters &filters,
+                                     const Commitment &commitment);
+
+  /// @brief subscribe to logsSubscribe with the given filter
+  int logsSubscribe(json &&filter,
+                    std::function<void(const Logs &, uint64_t)> logs_callback,
+                    const Commitment &commitment, Callback on_subscibe,
+                    Callback on_unsubscribe);
+
+  /// @brief send a subscription request with the current id
+  /// @param one_shot the server ends the subscription after its first
+  /// notification
+  /// @return subsccription id (actually the current id)
+  int subscribe(const std::string &subscribe_method,
+                const std::string &unsubscribe_method, json &&params,
+                Callback cb, RawCallback raw_cb, Callback on_subscibe,
+                Callback on_unsubscribe, bool one_shot = false);
+};
+
+/**
+ * Shard of an account among shards, a jump consistent hash of the public key.
+ * Keys are spread evenly and going from n to n + 1 shards only moves the keys
+ * that the new shard takes over
+ */
+size_t shardOf(const PublicKey &pub_key, size_t shards);
+
+///
+/// Account subscriptions spread over several connections
+///
+/// One WebSocketSubscriber is one socket and one io thread, which falls
+/// behind with tens of thousands of accounts. Every shard here is a
+/// WebSocketSubscriber of its own, an account always goes to the shard
+/// shardOf picks. The returned subscription ids are unique over all shards.
+class ShardedSubscriber {
+ public:
+  /// @brief connect shards subscribers to a ws:// or wss:// url, all options
+  /// apply to every shard. The shards connect in parallel
+  ShardedSubscriber(const std::string &url, size_t shards,
+                    int timeout_in_seconds = 30,
+                    ReconnectPolicy reconnect_policy = {},
+                    std::shared_ptr<ssl::context> ssl_context = nullptr,
+                    DispatchOptions dispatch_options = {});
+
+  /// @brief number of shards
+  size_t size() const;
+
+  /// @brief callback to call for every subscription restored after a
+  /// reconnect of its shard
+  /// @param on_gap callback to call
+  void onGap(GapCallback on_gap);
+
+  /// @brief see WebSocketSubscriber::onAccountChange
+  int onAccountChange(const solana::PublicKey &pub_key,
+                      Callback account_change_callback,
+                      const Commitment &commitment = Commitment::FINALIZED,
+                      Callback on_subscibe = nullptr,
+                      Callback on_unsubscribe = nullptr);
+
+  /// @brief see WebSocketSubscriber::onAccountChange
+  template <typename T>
+  int onAccountChange(
+      const solana::PublicKey &pub_key,
+      std::function<void(const AccountInfo<T> &, uint64_t)>
+          account_change_callback,
+      const Commitment &commitment = Commitment::FINALIZED,
+      Callback on_subscibe = nullptr, Callback on_unsubscribe = nullptr) {
+    const auto shard = shardOf(pub_key, shards_.size());
+    return shardedId(shard, shards_.size(),
+                     shards_[shard]->onAccountChange<T>(
+                         pub_key, std::move(account_change_callback),
+                         commitment, on_subscibe, on_unsubscribe));
+  }
+
+  /// @brief see WebSocketSubscriber::onAccountChange
+  template <typename T>
+  int onAccountChange(const solana::PublicKey &pub_key,
+                      std::shared_ptr<Conflated<AccountInfo<T>>> latest,
+                      const Commitment &commitment = Commitment::FINALIZED,
+                      Callback on_subscibe = nullptr,
+                      Callback on_unsubscribe = nullptr) {
+    const auto shard = shardOf(pub_key, shards_.size());
+    return shardedId(shard, shards_.size(),
+                     shards_[shard]->onAccountChange(
+                         pub_key, std::move(latest), commitment, on_subscibe,
+                         on_unsubscribe));
+  }
+
+  /// @brief remove the account change listener for the given id
+  /// @param sub_id the id returned by onAccountChange
+  void removeAccountChangeListener(RequestIdType sub_id);
+
+  /// @brief health of every shard
+  std::vector<SessionHealth> shardHealth() const;
+
+  /// @brief health summed over all shards, connected only if all shards are
+  SessionHealth health() const;
+
+ private:
+  /// @brief the id of a shard's subscription, unique over all shards
+  static int shardedId(size_t shard, size_t shards, RequestIdType id);
+
+  std::vector<std::unique_ptr<WebSocketSubscriber>> shards_;
 };
 }  // namespace subscription
 }  // namespace rpc
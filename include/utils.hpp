@@ -1,11 +1,16 @@
 #pragma once
 #include <fmt/format.h>
 
+#include <array>
+#include <tuple>
+#include <type_traits>
+
 #include "mango_v3.hpp"
 
 namespace mango_v3 {
 // quoteFree, quoteLocked, baseFree, baseLocked
-auto splitOpenOrders(const serum_v3::OpenOrders& openOrders) {
+template <typename OpenOrders>
+auto splitOpenOrders(const OpenOrders& openOrders) {
   const auto quoteFree =
       openOrders.quoteTokenFree + openOrders.referrerRebatesAccrued;
   const auto quoteLocked =
@@ -30,6 +35,46 @@ auto getQuotePosition(const PerpAccountInfo& accountInfo,
   return accountInfo.quotePosition -
          getUnsettledFunding(accountInfo, perpMarketCache);
 }
+/**
+ * Call f with healthType as a std::integral_constant, so that the health type
+ * specific parts of f are resolved at compile time
+ */
+template <typename F>
+decltype(auto) withHealthType(HealthType healthType, F&& f) {
+  switch (healthType) {
+    case HealthType::Maint:
+      return f(std::integral_constant<HealthType, HealthType::Maint>{});
+    case HealthType::Init:
+      return f(std::integral_constant<HealthType, HealthType::Init>{});
+    default:
+      return f(std::integral_constant<HealthType, HealthType::Unknown>{});
+  }
+}
+/**
+ * Return weights corresponding to health type;
+ * Weights are all 1 for HealthType::Unknown
+ * @return
+ * <spotAssetWeight, spotLiabWeight,perpAssetWeight, perpLiabWeight>
+ */
+template <HealthType healthType>
+auto getMangoGroupWeights(const MangoGroup& mangoGroup, uint64_t marketIndex) {
+  const auto& spotMarket = mangoGroup.spotMarkets[marketIndex];
+  const auto& perpMarket = mangoGroup.perpMarkets[marketIndex];
+  if constexpr (healthType == HealthType::Maint) {
+    return std::make_tuple(spotMarket.maintAssetWeight,
+                           spotMarket.maintLiabWeight,
+                           perpMarket.maintAssetWeight,
+                           perpMarket.maintLiabWeight);
+  } else if constexpr (healthType == HealthType::Init) {
+    return std::make_tuple(spotMarket.initAssetWeight,
+                           spotMarket.initLiabWeight,
+                           perpMarket.initAssetWeight,
+                           perpMarket.initLiabWeight);
+  } else {
+    const i80f48 one = 1L;
+    return std::make_tuple(one, one, one, one);
+  }
+}
 /**
  * Return weights corresponding to health type;
  * Weights are all 1 if no healthType provided
@@ -38,21 +83,53 @@ auto getQuotePosition(const PerpAccountInfo& accountInfo,
  */
 auto getMangoGroupWeights(const MangoGroup& mangoGroup, uint64_t marketIndex,
                           HealthType healthType = HealthType::Unknown) {
-  if (healthType == HealthType::Maint) {
-    return std::make_tuple(mangoGroup.spotMarkets[marketIndex].maintAssetWeight,
-                           mangoGroup.spotMarkets[marketIndex].maintLiabWeight,
-                           mangoGroup.perpMarkets[marketIndex].maintAssetWeight,
-                           mangoGroup.perpMarkets[marketIndex].maintLiabWeight);
-  } else if (healthType == HealthType::Init) {
-    return std::make_tuple(mangoGroup.spotMarkets[marketIndex].initAssetWeight,
-                           mangoGroup.spotMarkets[marketIndex].initLiabWeight,
-                           mangoGroup.perpMarkets[marketIndex].initAssetWeight,
-                           mangoGroup.perpMarkets[marketIndex].initLiabWeight);
-  } else {
-    return std::make_tuple(i80f48(1.0L), i80f48(1.0L), i80f48(1.0L),
-                           i80f48(1.0L));
+  return withHealthType(healthType, [&](auto type) {
+    return getMangoGroupWeights<decltype(type)::value>(mangoGroup, marketIndex);
+  });
+}
+/**
+ * Spot and perp weights of all markets of a group for one health type
+ */
+struct WeightTable {
+  std::array<i80f48, MAX_PAIRS> spotAsset{};
+  std::array<i80f48, MAX_PAIRS> spotLiab{};
+  std::array<i80f48, MAX_PAIRS> perpAsset{};
+  std::array<i80f48, MAX_PAIRS> perpLiab{};
+};
+template <HealthType healthType>
+WeightTable getWeightTable(const MangoGroup& mangoGroup) {
+  WeightTable table;
+  for (uint64_t i = 0; i < mangoGroup.numOracles; i++) {
+    std::tie(table.spotAsset[i], table.spotLiab[i], table.perpAsset[i],
+             table.perpLiab[i]) =
+        getMangoGroupWeights<healthType>(mangoGroup, i);
   }
+  return table;
 }
+/**
+ * Weight tables of every health type, built once when a MangoGroup is loaded
+ */
+struct GroupWeights {
+  explicit GroupWeights(const MangoGroup& mangoGroup)
+      : unknown(getWeightTable<HealthType::Unknown>(mangoGroup)),
+        init(getWeightTable<HealthType::Init>(mangoGroup)),
+        maint(getWeightTable<HealthType::Maint>(mangoGroup)) {}
+
+  template <HealthType healthType>
+  const WeightTable& get() const {
+    if constexpr (healthType == HealthType::Maint) {
+      return maint;
+    } else if constexpr (healthType == HealthType::Init) {
+      return init;
+    } else {
+      return unknown;
+    }
+  }
+
+  WeightTable unknown;
+  WeightTable init;
+  WeightTable maint;
+};
 auto nativeI80F48ToUi(i80f48 amount, uint8_t decimals) {
   return amount / pow(10.0L, decimals);
 }
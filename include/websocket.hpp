@@ -1,29 +1,67 @@
 #pragma once
 
 #include <boost/asio/buffers_iterator.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
+#include <boost/beast/ssl.hpp>
 #include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <future>
 #include <iostream>
 #include <memory>
 #include <nlohmann/json.hpp>
-#include <shared_mutex>
+#include <optional>
+#include <random>
 #include <string>
+#include <string_view>
 #include <thread>
 
+#include "dispatchPool.hpp"
+#include "flatIdMap.hpp"
+
 namespace beast = boost::beast;          // from <boost/beast.hpp>
 namespace http = beast::http;            // from <boost/beast/http.hpp>
 namespace websocket = beast::websocket;  // from <boost/beast/websocket.hpp>
 namespace net = boost::asio;             // from <boost/asio.hpp>
+namespace ssl = boost::asio::ssl;        // from <boost/asio/ssl.hpp>
 using tcp = boost::asio::ip::tcp;        // from <boost/asio/ip/tcp.hpp>
 using json = nlohmann::json;             // from <nlohmann/json.hpp>
 using Callback =
     std::function<void(const json &)>;  // callback function which takes
                                         // the json and returns nothing
+using RawCallback =
+    std::function<void(std::string_view)>;  // callback function which takes
+                                            // the unparsed notification text
 
 using RequestIdType = unsigned long;
+/// @brief called when a subscription was restored after a reconnect
+/// @param id the request id of the subscription
+/// @param last_slot slot of the last notification recieved before the
+/// connection dropped, 0 if there was none. Notifications after it were
+/// missed and can be backfilled over http
+using GapCallback = std::function<void(RequestIdType id, uint64_t last_slot)>;
+
+/// @brief Backoff between reconnection attempts
+struct ReconnectPolicy {
+  // backoff before the first attempt, doubled after every failed attempt
+  std::chrono::milliseconds initial_delay{100};
+  // backoff never grows beyond this
+  std::chrono::milliseconds max_delay{30000};
+
+  /// @brief delay before a reconnection attempt, randomized between half and
+  /// all of the backoff so that clients dropped together don't reconnect in
+  /// lockstep
+  /// @param attempt number of failed attempts since the last connection
+  /// @param rng source of the jitter
+  std::chrono::milliseconds delay(unsigned attempt, std::mt19937 &rng) const;
+};
+
 /// @brief Class to store the request and function given by user
 struct RequestContent {
   // id will be the id for subscription while id+1 will be id for unsubscription
@@ -34,11 +72,20 @@ struct RequestContent {
 
   // callback to call in case of notification
   Callback cb;
+  // called instead of cb with the notification text, which then isn't parsed
+  RawCallback raw_cb;
   Callback on_subscribe;
   Callback on_unsubscribe;
   // params to be passed with the subscription string
   json params;
   bool subscribed = false;
+  // the connection dropped while subscribed, the request is being replayed
+  bool resubscribing = false;
+  // an unsubscription request was sent, it is not replayed on reconnect
+  bool unsubscribing = false;
+  // the server ends the subscription after its first notification, like a
+  // signature subscription
+  bool one_shot = false;
   RequestIdType ws_id;
 
   RequestContent() = default;
@@ -59,21 +106,55 @@ struct RequestContent {
   json get_unsubscription_request(RequestIdType subscription_id) const;
 };
 
-// used to create a session to read and write to websocket
+/// @brief a notification waiting for a dispatch worker
+struct Notification {
+  // request id, notifications of one subscription go to the same worker
+  RequestIdType key = 0;
+  std::shared_ptr<const RequestContent> req;
+  std::string text;
+};
+
+/// @brief health of a session, read from any thread
+struct SessionHealth {
+  // the connection is up
+  bool connected;
+  // connections lost since the session started
+  uint64_t reconnects;
+  // subscriptions the server confirmed on the current connection
+  uint64_t subscriptions;
+  // notifications recieved for a subscription
+  uint64_t notifications;
+  solana::DispatchStats dispatch;
+};
+
+/// @brief tls client context verifying peers against the system's default
+/// certificate paths, created once and shared by all sessions using it
+std::shared_ptr<ssl::context> default_ssl_context();
+
+// used to create a session to read and write to websocket, over tls if an
+// ssl context is given
 class session : public std::enable_shared_from_this<session> {
  public:
   using HandshakePromisePtr = std::unique_ptr<std::promise<void>>;
   HandshakePromisePtr handshake_promise = nullptr;
   /// @brief resolver and websocket require an io context to do io operations
   /// @param ioc
+  /// @param ssl_context connect with wss:// using this context, plain ws://
+  /// if nullptr. Can be shared between sessions
+  /// @param dispatch_options run callbacks on a pool of workers instead of
+  /// the io thread if dispatch_options.workers > 0
   explicit session(net::io_context &ioc, int timeout_in_seconds = 30,
-                   HandshakePromisePtr handshake_callback = nullptr);
+                   HandshakePromisePtr handshake_callback = nullptr,
+                   ReconnectPolicy reconnect_policy = {},
+                   std::shared_ptr<ssl::context> ssl_context = nullptr,
+                   solana::DispatchOptions dispatch_options = {});
+  ~session();
 
   /// @brief Looks up the domain name to make connection to -> calls on_resolve
   /// @param host the host address
   /// @param port port number
-  /// @param text ping message
-  void run(std::string host, std::string port);
+  /// @param target path of the websocket endpoint
+  void run(std::string host, std::string port, std::string target = "/");
 
   /// @brief push a function for subscription
   /// @param req the request to call
@@ -83,31 +164,92 @@ class session : public std::enable_shared_from_this<session> {
   /// @param id the id to unsubscribe on
   void unsubscribe(RequestIdType id);
 
-  /// @brief disconnect from browser
+  /// @brief disconnect from browser, no reconnection is attempted afterwards
   void disconnect();
 
+  /// @brief set the callback called for every subscription restored after a
+  /// reconnect
+  /// @param on_gap the callback
+  void set_gap_callback(GapCallback on_gap);
+
   /// @brief check if connection has been stablished
   /// @return if connection has been established
   bool connection_established();
 
+  /// @brief counters of the dispatch pool, all zero without workers
+  solana::DispatchStats dispatch_stats() const;
+
+  /// @brief connection state and counters of the session
+  SessionHealth health() const;
+
  private:
   /// @brief log error messages
   /// @param ec the error code recieved from websocket
   /// @param what a text to log with error
   void fail(beast::error_code ec, char const *what);
 
+  /// @brief log the error and retry connecting after a backoff, unless
+  /// disconnect was called
+  /// @param ec the error code recieved from websocket
+  /// @param what a text to log with error
+  void reconnect(beast::error_code ec, char const *what);
+
+  /// @brief start a new connection once the backoff elapsed -> calls
+  /// on_resolve
+  /// @param ec error code of the timer, set if cancelled by disconnect
+  void on_reconnect_timer(beast::error_code ec);
+
+  /// @brief replay all subscriptions on a new connection
+  void resubscribe();
+
+  /// @brief queue a frame and start writing it unless a write is in progress
+  /// @param frame the text to write
+  void send(std::string frame);
+
+  /// @brief write the frame in front of the queue -> calls on_write
+  void do_write();
+
+  /// @brief write the next frame, or close if disconnect was called meanwhile
+  /// @param ec error code while writing
+  /// @param bytes_transferred Amount of byte written
+  void on_write(beast::error_code ec, std::size_t bytes_transferred);
+
+  /// @brief close the websocket, or just the socket if it isn't open
+  void close_stream();
+
+  /// @brief create a fresh websocket stream, plain or tls
+  void reset_stream();
+
+  /// @brief call f with the websocket stream in use
+  template <typename F>
+  void with_stream(F &&f) {
+    if (wss) {
+      f(*wss);
+    } else {
+      f(*ws);
+    }
+  }
+
   /// @brief Used to connect to the provided host -> calls on_connect
   /// @param ec error code in case of the resolve
   /// @param results the result of the resolve
   void on_resolve(beast::error_code ec, tcp::resolver::results_type results);
 
-  /// @brief Initiates handshake for the websocket connection -> calls
-  /// on_handshake
+  /// @brief Initiates the tls handshake, or the websocket handshake on plain
+  /// connections
   /// @param ec the error code during connect
   /// @param
   void on_connect(beast::error_code ec,
                   tcp::resolver::results_type::endpoint_type);
 
+  /// @brief Initiates the websocket handshake once tls is up
+  /// @param ec the error code during the tls handshake
+  void on_tls_handshake(beast::error_code ec);
+
+  /// @brief Initiates handshake for the websocket connection -> calls
+  /// on_handshake
+  void websocket_handshake();
+
   /// @brief Send the ping message once the handshake has been complete calls ->
   /// on_read
   /// @param ec error code on handshake
@@ -119,37 +261,102 @@ class session : public std::enable_shared_from_this<session> {
   /// @param bytes_transferred Amount of byte recieved
   void on_read(beast::error_code ec, std::size_t bytes_transferred);
 
-  /// @brief call the specified callback
-  /// @param data the data recieved from websocket
-  void call_callback(const json &data);
+  /// @brief handle the response to a subscription or unsubscription request
+  /// @param data the response recieved from websocket
+  void on_response(const json &data);
+
+  /// @brief call the callback of the subscription the notification is for
+  /// @param subscription the subscription id of the notification
+  /// @param slot the slot of the notification, 0 if it has none
+  /// @param text the notification recieved from websocket
+  void call_callback(RequestIdType subscription, uint64_t slot,
+                     std::string_view text);
 
   /// @brief close the connection from websocket
   /// @param ec the error code
   void on_close(beast::error_code ec);
 
-  /// @brief get callback
-  /// @param request_id
-  Callback get_callback(RequestIdType request_id);
+  /// @brief rebuild the dispatch table from the maps and publish it
+  void publish_dispatch_table();
+
+  /// @brief run the callback of req with a notification
+  static void invoke(const RequestContent &req, std::string_view text);
+
+  /// @brief retry handing conflated notifications to the dispatch pool until
+  /// all of them are queued
+  void schedule_flush();
+
+  // all handlers of the session run on this strand
+  net::strand<net::io_context::executor_type> strand;
 
   // resolves the host and port provided by user
   tcp::resolver resolver;
 
-  // socket used by client to read and write
-  websocket::stream<beast::tcp_stream> ws;
+  // tls context, nullptr for plain connections
+  std::shared_ptr<ssl::context> ssl_context;
+
+  // socket used by client to read and write, replaced on every reconnect.
+  // Only one of them is in use, depending on ssl_context
+  std::optional<websocket::stream<beast::tcp_stream>> ws;
+  std::optional<websocket::stream<beast::ssl_stream<beast::tcp_stream>>> wss;
+
+  // frames waiting to be written, the front one is being written while
+  // writing is set. Beast allows one write at a time, the queue pipelines the
+  // rest without blocking the caller
+  std::deque<std::string> write_queue;
+  bool writing = false;
+  // disconnect was called during a write, close once the queue is drained
+  bool close_pending = false;
 
   // buffer to store data
   beast::flat_buffer buffer;
 
-  // host
+  // host, port and path of the endpoint
   std::string host;
+  std::string port;
+  std::string target;
 
   // denotes if the connection is up
   std::atomic_bool is_connected;
 
-  // map of subscription id with callback
-  std::unordered_map<RequestIdType, RequestContent> callback_map;
+  // set by disconnect, stops reconnecting
+  std::atomic_bool is_closing;
+
+  // waits for the backoff between reconnection attempts
+  net::steady_timer reconnect_timer;
+  ReconnectPolicy reconnect_policy;
+  unsigned reconnect_attempt = 0;
+  std::mt19937 rng;
+
+  // counters of health()
+  std::atomic<uint64_t> reconnects{0};
+  std::atomic<uint64_t> confirmed_subscriptions{0};
+  std::atomic<uint64_t> notifications{0};
+
+  // called when a subscription was restored
+  GapCallback on_gap;
+
+  // slot of the last notification per request id
+  std::unordered_map<RequestIdType, uint64_t> last_slots;
+
+  // map of subscription id with callback. subscribe and unsubscribe post
+  // their changes to the strand, so the maps are only used on the strand
+  std::unordered_map<RequestIdType, std::shared_ptr<RequestContent>>
+      callback_map;
   std::unordered_map<RequestIdType, RequestIdType> maps_wsid_to_id;
-  std::shared_mutex mutex_for_maps;
+
+  // snapshot of maps_wsid_to_id resolved to the requests in callback_map,
+  // so a notification takes a single probe. Replaced tables are freed on the
+  // strand, after dispatches still using them are done
+  using DispatchTable =
+      solana::FlatIdMap<std::shared_ptr<const RequestContent>>;
+  std::atomic<const DispatchTable *> dispatch_table;
+
+  // runs callbacks off the io thread, nullptr to run them inline
+  std::unique_ptr<solana::DispatchPool<Notification>> dispatch_pool;
+  // retries conflated notifications
+  net::steady_timer flush_timer;
+  bool flush_scheduled = false;
 
   // connection timeout
   int connection_timeout = 30;
@@ -1,19 +1,23 @@
 #include "solana.hpp"
 
 #include <cpr/cpr.h>
+#include <curl/curl.h>
 #include <sodium.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <future>
 #include <iterator>
+#include <map>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <ostream>
 #include <solana.hpp>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "base64.hpp"
@@ -29,8 +33,10 @@ PublicKey PublicKey::empty() { return {}; }
 
 PublicKey PublicKey::fromBase58(const std::string &b58) {
   PublicKey result = {};
-  size_t decodedSize = SIZE;
-  const auto ok = b58tobin(result.data.data(), &decodedSize, b58.c_str(), 0);
+  static_assert(SIZE == 32, "b58decode32 expects 32 byte keys");
+  size_t decodedSize = 0;
+  const auto ok =
+      b58decode32(b58.data(), b58.size(), result.data.data(), &decodedSize);
   if (!ok) throw std::runtime_error("invalid base58 '" + b58 + "'");
   if (decodedSize != SIZE)
     throw std::runtime_error("not a valid PublicKey '" +
@@ -43,7 +49,22 @@ bool PublicKey::operator==(const PublicKey &other) const {
   return data == other.data;
 }
 
-std::string PublicKey::toBase58() const { return b58encode(data); }
+bool PublicKey::operator!=(const PublicKey &other) const {
+  return data != other.data;
+}
+
+bool PublicKey::operator<(const PublicKey &other) const {
+  return data < other.data;
+}
+
+std::string PublicKey::toBase58() const {
+  char b58[B58_32_MAX_SIZE];
+  return std::string(b58, toBase58(b58));
+}
+
+size_t PublicKey::toBase58(char (&out)[B58_32_MAX_SIZE]) const {
+  return b58encode32(data.data(), out);
+}
 
 void to_json(json &j, const PublicKey &key) { j = key.toBase58(); }
 
@@ -442,6 +463,84 @@ void to_json(json &j, const GetSignatureAddressConfig &signatureaddressconfig) {
   }
 }
 
+void to_json(json &j, const ProgramAccountFilters &filters) {
+  j = json::array();
+  if (filters.dataSize.has_value()) {
+    j.push_back({{"dataSize", filters.dataSize.value()}});
+  }
+  for (const auto &memcmp : filters.memcmp) {
+    j.push_back(
+        {{"memcmp", {{"offset", memcmp.offset}, {"bytes", memcmp.bytes}}}});
+  }
+}
+
+void decodeTransactionError(JsonScanner &scanner,
+                            std::optional<std::string> &err) {
+  if (scanner.null()) {
+    err = std::nullopt;
+  } else {
+    err = std::string(scanner.skipValue());
+  }
+}
+
+void decodeSlotNotification(std::string_view body, SlotInfo &info) {
+  decodeNotificationResult(body, [&](JsonScanner &scanner) {
+    scanner.object([&](std::string_view key) {
+      if (key == "parent") {
+        info.parent = scanner.unsignedInteger();
+      } else if (key == "root") {
+        info.root = scanner.unsignedInteger();
+      } else if (key == "slot") {
+        info.slot = scanner.unsignedInteger();
+      } else {
+        scanner.skipValue();
+      }
+    });
+  });
+}
+
+uint64_t decodeSignatureNotification(std::string_view body,
+                                     SignatureResult &result) {
+  return decodeNotification(
+      body, result, [](JsonScanner &scanner, SignatureResult &result) {
+        scanner.object([&](std::string_view key) {
+          if (key == "err") {
+            decodeTransactionError(scanner, result.err);
+          } else {
+            scanner.skipValue();
+          }
+        });
+      });
+}
+
+uint64_t decodeLogsNotification(std::string_view body, Logs &logs) {
+  return decodeNotification(body, logs, [](JsonScanner &scanner, Logs &logs) {
+    scanner.object([&](std::string_view key) {
+      if (key == "signature") {
+        logs.signature = scanner.string();
+      } else if (key == "err") {
+        decodeTransactionError(scanner, logs.err);
+      } else if (key == "logs") {
+        // log messages can contain escaped characters, let json resolve them
+        if (scanner.null()) {
+          logs.logs.clear();
+        } else {
+          logs.logs = json::parse(scanner.skipValue());
+        }
+      } else {
+        scanner.skipValue();
+      }
+    });
+  });
+}
+
+uint64_t decodeRootNotification(std::string_view body) {
+  uint64_t root = 0;
+  decodeNotificationResult(
+      body, [&](JsonScanner &scanner) { root = scanner.unsignedInteger(); });
+  return root;
+}
+
 ///
 /// CompactU16
 namespace CompactU16 {
@@ -592,8 +691,8 @@ std::vector<uint8_t> CompiledTransaction::sign(const Keypair &keypair) const {
 
 namespace rpc {
 
-json jsonRequest(const std::string &method, const json &params) {
-  json req = {{"jsonrpc", "2.0"}, {"id", 1}, {"method", method}};
+json jsonRequest(const std::string &method, const json &params, uint64_t id) {
+  json req = {{"jsonrpc", "2.0"}, {"id", id}, {"method", method}};
   if (params != nullptr) req["params"] = params;
   return req;
 }
@@ -654,32 +753,417 @@ void to_json(json &j, const GetAccountInfoConfig &config) {
   }
 }
 
+///
+/// SessionPool
+SessionPool::Lease::Lease(SessionPool &pool,
+                          std::unique_ptr<cpr::Session> session)
+    : pool_(&pool), session_(std::move(session)) {}
+
+SessionPool::Lease::~Lease() {
+  // moved-from leases don't own a session anymore
+  if (session_) pool_->checkin(std::move(session_));
+}
+
+SessionPool::SessionPool(const std::string &url, size_t size)
+    : url_(url), size_(size) {
+  idle_.reserve(size_);
+}
+
+SessionPool::Lease SessionPool::checkout() {
+  {
+    std::lock_guard lk(mutex_);
+    if (!idle_.empty()) {
+      // most recently used session is the most likely to still be connected
+      auto session = std::move(idle_.back());
+      idle_.pop_back();
+      return {*this, std::move(session)};
+    }
+  }
+  // create the session outside of the lock, all of them share url & headers
+  auto session = std::make_unique<cpr::Session>();
+  session->SetUrl(cpr::Url{url_});
+  session->SetHeader(cpr::Header{{"Content-Type", "application/json"}});
+  return {*this, std::move(session)};
+}
+
+size_t SessionPool::idle() const {
+  std::lock_guard lk(mutex_);
+  return idle_.size();
+}
+
+void SessionPool::checkin(std::unique_ptr<cpr::Session> session) {
+  std::lock_guard lk(mutex_);
+  // close sessions which exceed the pool size
+  if (idle_.size() < size_) idle_.push_back(std::move(session));
+}
+
+/**
+ * check the http status of a json rpc response
+ * @return result from response
+ */
+static json resultFromResponse(long status_code, const std::string &text) {
+  if (status_code != 200)
+    throw std::runtime_error("unexpected status_code " +
+                             std::to_string(status_code));
+
+  const auto resJson = json::parse(text);
+
+  if (resJson.contains("error")) {
+    throw std::runtime_error(resJson["error"].dump());
+  }
+
+  return resJson["result"];
+}
+
+/**
+ * Blockhash from the result of getLatestBlockhash
+ */
+static Blockhash blockhashFromResult(const json &res) {
+  const json value = res.at("value");
+  // create Blockhash from response
+  const PublicKey blockhash = PublicKey::fromBase58(value.at("blockhash"));
+  const uint64_t lastValidBlockHeight =
+      static_cast<uint64_t>(value.at("lastValidBlockHeight"));
+  return {blockhash, lastValidBlockHeight};
+}
+
+/**
+ * statuses from the result of getSignatureStatuses
+ */
+static RpcResponseAndContext<std::vector<std::optional<SignatureStatus>>>
+signatureStatusesFromResult(const json &res) {
+  // parse response and handle null status
+  const std::vector<json> value = res["value"];
+  std::vector<std::optional<SignatureStatus>> status_list;
+  status_list.reserve(value.size());
+
+  for (const json &status : value) {
+    if (status.is_null()) {
+      status_list.push_back(std::nullopt);
+    } else {
+      status_list.push_back(std::optional{status});
+    }
+  }
+
+  return {res["context"], status_list};
+}
+
+/**
+ * context and value from the result of a request
+ */
+template <typename T>
+static RpcResponseAndContext<T> contextAndValueFromResult(const json &res) {
+  return {res["context"], res["value"].get<T>()};
+}
+
+/**
+ * schedule from the result of getLeaderSchedule
+ */
+static std::vector<std::pair<std::string, std::vector<uint64_t>>>
+leaderScheduleFromResult(const json &byIdentity) {
+  std::vector<std::pair<std::string, std::vector<uint64_t>>> vec;
+  for (auto it = byIdentity.begin(); it != byIdentity.end(); ++it) {
+    vec.emplace_back(it.key(), it.value());
+  }
+  return vec;
+}
+
+///
+/// RequestLoop
+///
+/// Sends asynchronous requests through a single curl multi handle. All
+/// transfers, including their keep-alive connections, are driven by one thread
+/// which is started on the first request, so a single thread can keep any
+/// number of requests in flight.
+class RequestLoop {
+ public:
+  explicit RequestLoop(const std::string &url)
+      : worker_(std::make_shared<Worker>(url)) {}
+
+  ~RequestLoop() {
+    worker_->stop();
+    if (!thread_.joinable()) return;
+    // the last copy of a Connection can be released by one of its handlers,
+    // the worker then finishes on its own as the thread shares its ownership
+    if (thread_.get_id() == std::this_thread::get_id()) {
+      thread_.detach();
+    } else {
+      thread_.join();
+    }
+  }
+
+  /**
+   * queue a json rpc request body, handler is called once it completed
+   */
+  void submit(std::string body, ResponseHandler handler) {
+    std::call_once(started_, [this]() {
+      thread_ = std::thread([worker = worker_]() { worker->run(); });
+    });
+    worker_->submit(std::move(body), std::move(handler));
+  }
+
+  /**
+   * call fn on the request thread once delay has passed
+   */
+  void schedule(std::chrono::milliseconds delay, std::function<void()> fn) {
+    worker_->schedule(delay, std::move(fn));
+  }
+
+ private:
+  struct Worker {
+    struct Transfer {
+      std::string body;
+      std::string response;
+      ResponseHandler handler;
+    };
+
+    explicit Worker(const std::string &url) : url_(url) {
+      globalInit();
+      multi_ = curl_multi_init();
+      headers_ = curl_slist_append(nullptr, "Content-Type: application/json");
+    }
+
+    ~Worker() {
+      for (auto &[easy, transfer] : active_) {
+        curl_multi_remove_handle(multi_, easy);
+        curl_easy_cleanup(easy);
+      }
+      for (auto easy : idle_) curl_easy_cleanup(easy);
+      curl_multi_cleanup(multi_);
+      curl_slist_free_all(headers_);
+    }
+
+    void submit(std::string body, ResponseHandler handler) {
+      {
+        std::lock_guard lk(mutex_);
+        if (!stopped_) {
+          queued_.push_back(std::make_unique<Transfer>(
+              Transfer{std::move(body), {}, std::move(handler)}));
+          curl_multi_wakeup(multi_);
+          return;
+        }
+      }
+      fail(handler);
+    }
+
+    void schedule(std::chrono::milliseconds delay, std::function<void()> fn) {
+      std::lock_guard lk(mutex_);
+      if (stopped_) return;
+      timers_.emplace(std::chrono::steady_clock::now() + delay, std::move(fn));
+      curl_multi_wakeup(multi_);
+    }
+
+    void stop() {
+      std::lock_guard lk(mutex_);
+      stopped_ = true;
+      curl_multi_wakeup(multi_);
+    }
+
+    void run() {
+      std::vector<std::unique_ptr<Transfer>> queued;
+      std::vector<std::function<void()>> due;
+      while (true) {
+        {
+          std::lock_guard lk(mutex_);
+          if (stopped_) break;
+          queued.swap(queued_);
+          const auto now = std::chrono::steady_clock::now();
+          while (!timers_.empty() && timers_.begin()->first <= now) {
+            due.push_back(std::move(timers_.begin()->second));
+            timers_.erase(timers_.begin());
+          }
+        }
+        for (auto &transfer : queued) start(std::move(transfer));
+        queued.clear();
+        for (auto &fn : due) invoke(fn);
+        due.clear();
+
+        int running = 0;
+        curl_multi_perform(multi_, &running);
+        int left = 0;
+        while (const auto msg = curl_multi_info_read(multi_, &left)) {
+          if (msg->msg == CURLMSG_DONE)
+            finish(msg->easy_handle, msg->data.result);
+        }
+
+        curl_multi_poll(multi_, nullptr, 0, pollTimeout(), nullptr);
+      }
+
+      // fail everything still pending, handlers may release the last owner
+      std::vector<std::unique_ptr<Transfer>> pending;
+      {
+        std::lock_guard lk(mutex_);
+        pending.swap(queued_);
+        timers_.clear();
+      }
+      for (auto &[easy, transfer] : active_)
+        pending.push_back(std::move(transfer));
+      for (auto &transfer : pending) fail(transfer->handler);
+    }
+
+   private:
+    /**
+     * curl_global_init isn't thread safe, run it once before any handle exists
+     */
+    static void globalInit() {
+      static std::once_flag initialized;
+      std::call_once(initialized, []() { curl_global_init(CURL_GLOBAL_ALL); });
+    }
+
+    /**
+     * milliseconds until the next timer is due, capped to check for new
+     * requests regularly even if a wakeup got lost
+     */
+    int pollTimeout() {
+      std::lock_guard lk(mutex_);
+      if (!queued_.empty()) return 0;
+      if (timers_.empty()) return 1000;
+      const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+          timers_.begin()->first - std::chrono::steady_clock::now());
+      return std::clamp(static_cast<int>(wait.count()), 0, 1000);
+    }
+
+    void start(std::unique_ptr<Transfer> transfer) {
+      CURL *easy;
+      if (idle_.empty()) {
+        easy = curl_easy_init();
+        curl_easy_setopt(easy, CURLOPT_URL, url_.c_str());
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers_);
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write);
+      } else {
+        easy = idle_.back();
+        idle_.pop_back();
+      }
+      curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE,
+                       static_cast<long>(transfer->body.size()));
+      curl_easy_setopt(easy, CURLOPT_POSTFIELDS, transfer->body.data());
+      curl_easy_setopt(easy, CURLOPT_WRITEDATA, &transfer->response);
+      active_.emplace(easy, std::move(transfer));
+      curl_multi_add_handle(multi_, easy);
+    }
+
+    void finish(CURL *easy, CURLcode result) {
+      curl_multi_remove_handle(multi_, easy);
+      auto node = active_.extract(easy);
+      auto &transfer = node.mapped();
+      long status_code = 0;
+      curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status_code);
+      idle_.push_back(easy);
+
+      json res;
+      std::exception_ptr error;
+      try {
+        if (result != CURLE_OK)
+          throw std::runtime_error(curl_easy_strerror(result));
+        res = resultFromResponse(status_code, transfer->response);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      invoke(transfer->handler, error, std::move(res));
+    }
+
+    static void fail(const ResponseHandler &handler) {
+      invoke(handler,
+             std::make_exception_ptr(std::runtime_error("connection closed")),
+             nullptr);
+    }
+
+    /**
+     * handlers run on the request thread, an exception escaping one of them
+     * must not take down the other requests
+     */
+    template <typename Fn, typename... Args>
+    static void invoke(const Fn &fn, Args &&...args) {
+      try {
+        fn(std::forward<Args>(args)...);
+      } catch (...) {
+      }
+    }
+
+    static size_t write(char *data, size_t size, size_t count, void *out) {
+      static_cast<std::string *>(out)->append(data, size * count);
+      return size * count;
+    }
+
+    const std::string url_;
+    CURLM *multi_;
+    curl_slist *headers_;
+    std::mutex mutex_;
+    // guarded by mutex_
+    bool stopped_ = false;
+    std::vector<std::unique_ptr<Transfer>> queued_;
+    std::multimap<std::chrono::steady_clock::time_point, std::function<void()>>
+        timers_;
+    // only accessed by the request thread
+    std::unordered_map<CURL *, std::unique_ptr<Transfer>> active_;
+    std::vector<CURL *> idle_;
+  };
+
+  std::shared_ptr<Worker> worker_;
+  std::once_flag started_;
+  std::thread thread_;
+};
+
 ///
 /// Connection
-Connection::Connection(const std::string &rpc_url)
-    : rpc_url_(std::move(rpc_url)) {
+Connection::Connection(const std::string &rpc_url, size_t session_pool_size)
+    : rpc_url_(rpc_url),
+      sessions_(std::make_shared<SessionPool>(rpc_url, session_pool_size)),
+      requests_(std::make_shared<RequestLoop>(rpc_url)) {
   auto sodium_result = sodium_init();
   if (sodium_result < -1)
     throw std::runtime_error("Error initializing sodium: " +
                              std::to_string(sodium_result));
 }
 
+cpr::Response Connection::post(const json &body) const {
+  auto session = sessions_->checkout();
+  session->SetBody(cpr::Body{body.dump()});
+  return session->Post();
+}
+
 json Connection::sendJsonRpcRequest(const json &body) const {
-  cpr::Response res =
-      cpr::Post(cpr::Url{rpc_url_}, cpr::Body{body.dump()},
-                cpr::Header{{"Content-Type", "application/json"}});
+  const auto res = post(body);
+  return resultFromResponse(res.status_code, res.text);
+}
+
+std::string Connection::sendRawJsonRpcRequest(const json &body) const {
+  auto res = post(body);
 
   if (res.status_code != 200)
     throw std::runtime_error("unexpected status_code " +
                              std::to_string(res.status_code));
 
-  const auto resJson = json::parse(res.text);
+  return std::move(res.text);
+}
 
-  if (resJson.contains("error")) {
-    throw std::runtime_error(resJson["error"].dump());
+json Connection::sendJsonRpcBatch(const json &requests) const {
+  const auto res = post(requests);
+
+  if (res.status_code != 200)
+    throw std::runtime_error("unexpected status_code " +
+                             std::to_string(res.status_code));
+
+  auto resJson = json::parse(res.text);
+
+  // a batch that can't be processed at all is answered with a single error
+  if (!resJson.is_array()) {
+    throw std::runtime_error(resJson.contains("error")
+                                 ? resJson["error"].dump()
+                                 : "unexpected batch response " + res.text);
   }
 
-  return resJson["result"];
+  return resJson;
+}
+
+void Connection::sendJsonRpcRequestAsync(const json &body,
+                                         ResponseHandler handler) const {
+  requests_->submit(body.dump(), std::move(handler));
+}
+
+std::future<json> Connection::sendJsonRpcRequestAsync(const json &body) const {
+  return sendAsync<json>(body, [](const json &res) { return res; });
 }
 
 std::string Connection::signAndSendTransaction(
@@ -761,13 +1245,7 @@ Blockhash Connection::getLatestBlockhash(const Commitment &commitment) const {
   const json params = {{{"commitment", commitment}}};
   const json reqJson = jsonRequest("getLatestBlockhash", params);
   // send jsonRpc request
-  const json res = sendJsonRpcRequest(reqJson);
-  const json value = res["value"];
-  // create Blockhash from response
-  const PublicKey blockhash = PublicKey::fromBase58(value["blockhash"]);
-  const uint64_t lastValidBlockHeight =
-      static_cast<uint64_t>(value["lastValidBlockHeight"]);
-  return {blockhash, lastValidBlockHeight};
+  return blockhashFromResult(sendJsonRpcRequest(reqJson));
 }
 
 uint64_t Connection::getBlockHeight(const Commitment &commitment) const {
@@ -786,21 +1264,7 @@ Connection::getSignatureStatuses(const std::vector<std::string> &signatures,
       signatures, {{"searchTransactionHistory", searchTransactionHistory}}};
   const auto reqJson = jsonRequest("getSignatureStatuses", params);
   // send jsonRpc request
-  const json res = sendJsonRpcRequest(reqJson);
-  // parse response and handle null status
-  const std::vector<json> value = res["value"];
-  std::vector<std::optional<SignatureStatus>> status_list;
-  status_list.reserve(value.size());
-
-  for (const json &status : value) {
-    if (status.is_null()) {
-      status_list.push_back(std::nullopt);
-    } else {
-      status_list.push_back(std::optional{status});
-    }
-  }
-
-  return {res["context"], status_list};
+  return signatureStatusesFromResult(sendJsonRpcRequest(reqJson));
 }
 
 RpcResponseAndContext<std::optional<SignatureStatus>>
@@ -931,12 +1395,8 @@ RpcResponseAndContext<std::vector<LargestAccounts>>
 Connection::getLargestAccounts(const LargestAccountsConfig &config) const {
   const json params = {config};
   const auto reqJson = jsonRequest("getLargestAccounts", params);
-  const json res = sendJsonRpcRequest(reqJson);
-  const std::vector<json> value = res["value"];
-  std::vector<LargestAccounts> accounts_list;
-  accounts_list.reserve(value.size());
-  std::copy(value.begin(), value.end(), std::back_inserter(accounts_list));
-  return {res["context"], accounts_list};
+  return contextAndValueFromResult<std::vector<LargestAccounts>>(
+      sendJsonRpcRequest(reqJson));
 }
 
 std::vector<RecentPerformanceSamples> Connection::getRecentPerformanceSamples(
@@ -962,18 +1422,15 @@ RpcResponseAndContext<Supply> Connection::getSupply(
     const GetSupplyConfig &config) const {
   const json params = {config};
   const auto reqJson = jsonRequest("getSupply", params);
-  const json res = sendJsonRpcRequest(reqJson);
-  Supply accounts_list = res["value"];
-  return {res["context"], accounts_list};
+  return contextAndValueFromResult<Supply>(sendJsonRpcRequest(reqJson));
 }
 
 RpcResponseAndContext<TokenAccountBalance> Connection::getTokenAccountBalance(
     const std::string pubkey, const commitmentconfig &config) const {
   const json params = {pubkey, config};
   const auto reqJson = jsonRequest("getTokenAccountBalance", params);
-  const json res = sendJsonRpcRequest(reqJson);
-  TokenAccountBalance accounts_list = res["value"];
-  return {res["context"], accounts_list};
+  return contextAndValueFromResult<TokenAccountBalance>(
+      sendJsonRpcRequest(reqJson));
 }
 
 VoteAccounts Connection::getVoteAccounts(
@@ -1001,12 +1458,8 @@ Connection::getTokenLargestAccounts(std::string pubkey,
                                     const commitmentconfig &config) const {
   const json params = {pubkey, config};
   const auto reqJson = jsonRequest("getTokenLargestAccounts", params);
-  const json res = sendJsonRpcRequest(reqJson);
-  const std::vector<json> value = res["value"];
-  std::vector<TokenLargestAccounts> accounts_list;
-  accounts_list.reserve(value.size());
-  std::copy(value.begin(), value.end(), std::back_inserter(accounts_list));
-  return {res["context"], accounts_list};
+  return contextAndValueFromResult<std::vector<TokenLargestAccounts>>(
+      sendJsonRpcRequest(reqJson));
 }
 
 std::vector<uint64_t> Connection::getBlocks(
@@ -1042,12 +1495,7 @@ Connection::getLeaderSchedule(const std::optional<uint64_t> slot,
     params = {config};
   }
   const auto reqJson = jsonRequest("getLeaderSchedule", params);
-  std::vector<std::pair<std::string, std::vector<uint64_t>>> vec;
-  const json byIdentity = sendJsonRpcRequest(reqJson);
-  for (auto it = byIdentity.begin(); it != byIdentity.end(); ++it) {
-    vec.emplace_back(it.key(), it.value());
-  }
-  return vec;
+  return leaderScheduleFromResult(sendJsonRpcRequest(reqJson));
 }
 
 RpcResponseAndContext<std::vector<TokenAccountsByOwner>>
@@ -1056,9 +1504,487 @@ Connection::getTokenAccountsByOwner(
     const TokenAccountsByOwnerConfig &config) const {
   const json params = {pubkey, mPconfig, config};
   const auto reqJson = jsonRequest("getTokenAccountsByOwner", params);
-  const json res = sendJsonRpcRequest(reqJson);
-  const json value = res["value"];
-  return {res["context"], value};
+  return contextAndValueFromResult<std::vector<TokenAccountsByOwner>>(
+      sendJsonRpcRequest(reqJson));
+}
+
+///
+/// Asynchronous Connection methods
+std::future<std::string> Connection::sendTransactionAsync(
+    const Keypair &keypair, const CompiledTransaction &compiledTx,
+    const SendTransactionConfig &config) const {
+  // sign and encode transaction
+  const auto signedTx = compiledTx.sign(keypair);
+  const auto b64Tx = b64encode(std::string(signedTx.begin(), signedTx.end()));
+  // queue jsonRpc request
+  return sendEncodedTransactionAsync(b64Tx, config);
+}
+
+std::future<std::string> Connection::sendRawTransactionAsync(
+    const std::vector<uint8_t> &signedTx,
+    const SendTransactionConfig &config) const {
+  // base64 encode transaction
+  const auto b64Tx = b64encode(std::string(signedTx.begin(), signedTx.end()));
+  // queue jsonRpc request
+  return sendEncodedTransactionAsync(b64Tx, config);
+}
+
+std::future<std::string> Connection::sendEncodedTransactionAsync(
+    const std::string &b64Tx, const SendTransactionConfig &config) const {
+  const json params = {b64Tx, config};
+  const json reqJson = jsonRequest("sendTransaction", params);
+  return sendAsync<std::string>(reqJson);
+}
+
+std::future<SimulatedTransactionResponse> Connection::simulateTransactionAsync(
+    const Keypair &keypair, const CompiledTransaction &compiledTx,
+    const SimulateTransactionConfig &config) const {
+  // signed and encode transaction
+  const auto signedTx = compiledTx.sign(keypair);
+  const auto b64Tx = b64encode(std::string(signedTx.begin(), signedTx.end()));
+  const json params = {b64Tx, config};
+  const auto reqJson = jsonRequest("simulateTransaction", params);
+  return sendAsync<SimulatedTransactionResponse>(
+      reqJson, [](const json &res) {
+        return res["value"].get<SimulatedTransactionResponse>();
+      });
+}
+
+std::future<std::string> Connection::requestAirdropAsync(
+    const PublicKey &pubkey, uint64_t lamports) const {
+  const json params = {pubkey.toBase58(), lamports};
+  const json reqJson = jsonRequest("requestAirdrop", params);
+  return sendAsync<std::string>(reqJson);
+}
+
+std::future<uint64_t> Connection::getBalanceAsync(
+    const PublicKey &pubkey) const {
+  const json params = {pubkey.toBase58()};
+  const json reqJson = jsonRequest("getBalance", params);
+  return sendAsync<uint64_t>(
+      reqJson, [](const json &res) { return res["value"].get<uint64_t>(); });
+}
+
+std::future<Blockhash> Connection::getLatestBlockhashAsync(
+    const Commitment &commitment) const {
+  const json params = {{{"commitment", commitment}}};
+  const json reqJson = jsonRequest("getLatestBlockhash", params);
+  return sendAsync<Blockhash>(reqJson, blockhashFromResult);
+}
+
+std::future<uint64_t> Connection::getBlockHeightAsync(
+    const Commitment &commitment) const {
+  const json params = {{{"commitment", commitment}}};
+  const json reqJson = jsonRequest("getBlockHeight", params);
+  return sendAsync<uint64_t>(reqJson);
+}
+
+std::future<bool> Connection::confirmTransactionAsync(
+    std::string transactionSignature, Commitment confirmLevel,
+    uint16_t retries) const {
+  // state of one confirmation, shared by the chain of request handlers
+  struct Confirmation {
+    Connection connection;
+    std::string signature;
+    Commitment confirmLevel;
+    uint16_t retries;
+    uint64_t timeoutBlockheight = 0;
+    std::promise<bool> promise;
+
+    static void start(std::shared_ptr<Confirmation> c) {
+      const json params = {{{"commitment", c->confirmLevel}}};
+      c->connection.sendJsonRpcRequestAsync(
+          jsonRequest("getLatestBlockhash", params),
+          [c](std::exception_ptr error, json res) {
+            if (error) return c->promise.set_exception(error);
+            try {
+              c->timeoutBlockheight =
+                  blockhashFromResult(res).lastValidBlockHeight +
+                  solana::MAXIMUM_NUMBER_OF_BLOCKS_FOR_TRANSACTION;
+            } catch (...) {
+              return c->promise.set_exception(std::current_exception());
+            }
+            poll(c);
+          });
+    }
+
+    static void poll(std::shared_ptr<Confirmation> c) {
+      if (c->retries == 0) return c->promise.set_value(false);
+      const json params = {{{"commitment", c->confirmLevel}}};
+      c->connection.sendJsonRpcRequestAsync(
+          jsonRequest("getBlockHeight", params),
+          [c](std::exception_ptr error, json res) {
+            if (error) return c->promise.set_exception(error);
+            uint64_t currentBlockheight;
+            try {
+              currentBlockheight = res.get<uint64_t>();
+            } catch (...) {
+              return c->promise.set_exception(std::current_exception());
+            }
+            checkStatus(c, currentBlockheight);
+          });
+    }
+
+    static void checkStatus(std::shared_ptr<Confirmation> c,
+                            uint64_t currentBlockheight) {
+      const json params = {std::vector<std::string>{c->signature},
+                           {{"searchTransactionHistory", true}}};
+      c->connection.sendJsonRpcRequestAsync(
+          jsonRequest("getSignatureStatuses", params),
+          [c, currentBlockheight](std::exception_ptr error, json res) {
+            if (error) return c->promise.set_exception(error);
+            if (c->timeoutBlockheight <= currentBlockheight)
+              return c->promise.set_exception(std::make_exception_ptr(
+                  std::runtime_error("Transaction timeout")));
+            try {
+              const auto status = signatureStatusesFromResult(res).value[0];
+              if (status.has_value() &&
+                  status.value().confirmationStatus == c->confirmLevel) {
+                return c->promise.set_value(true);
+              }
+            } catch (...) {
+              return c->promise.set_exception(std::current_exception());
+            }
+            c->retries--;
+            c->connection.requests_->schedule(std::chrono::milliseconds(500),
+                                              [c]() { poll(c); });
+          });
+    }
+  };
+
+  auto confirmation = std::make_shared<Confirmation>(
+      Confirmation{*this, std::move(transactionSignature), confirmLevel,
+                   retries});
+  auto future = confirmation->promise.get_future();
+  Confirmation::start(confirmation);
+  return future;
+}
+
+std::future<RpcResponseAndContext<std::vector<std::optional<SignatureStatus>>>>
+Connection::getSignatureStatusesAsync(
+    const std::vector<std::string> &signatures,
+    bool searchTransactionHistory) const {
+  const json params = {
+      signatures, {{"searchTransactionHistory", searchTransactionHistory}}};
+  const auto reqJson = jsonRequest("getSignatureStatuses", params);
+  return sendAsync<
+      RpcResponseAndContext<std::vector<std::optional<SignatureStatus>>>>(
+      reqJson, signatureStatusesFromResult);
+}
+
+std::future<Version> Connection::getVersionAsync() const {
+  json params = {};
+  const json reqJson = jsonRequest("getVersion", params);
+  return sendAsync<Version>(reqJson);
+}
+
+std::future<uint64_t> Connection::minimumLedgerSlotAsync() const {
+  const json params = {};
+  const json reqJson = jsonRequest("minimumLedgerSlot", params);
+  return sendAsync<uint64_t>(reqJson);
+}
+
+std::future<std::string> Connection::getGenesisHashAsync() const {
+  const json params = {};
+  const json reqJson = jsonRequest("getGenesisHash", params);
+  return sendAsync<std::string>(reqJson);
+}
+
+std::future<EpochSchedule> Connection::getEpochScheduleAsync() const {
+  json params = {};
+  const json reqJson = jsonRequest("getEpochSchedule", params);
+  return sendAsync<EpochSchedule>(reqJson);
+}
+
+std::future<uint64_t> Connection::getSlotAsync(
+    const GetSlotConfig &config) const {
+  const json params = {config};
+  const json reqJson = jsonRequest("getSlot", params);
+  return sendAsync<uint64_t>(reqJson);
+}
+
+std::future<std::string> Connection::getSlotLeaderAsync(
+    const GetSlotConfig &config) const {
+  const json params = {config};
+  const json reqJson = jsonRequest("getSlotLeader", params);
+  return sendAsync<std::string>(reqJson);
+}
+
+std::future<uint64_t> Connection::getFirstAvailableBlockAsync() const {
+  json params = {};
+  const json reqJson = jsonRequest("getFirstAvailableBlock", params);
+  return sendAsync<uint64_t>(reqJson);
+}
+
+std::future<StakeActivation> Connection::getStakeActivationAsync(
+    const PublicKey &pubkey, const GetStakeActivationConfig &config) const {
+  const json params = {pubkey, config};
+  const json reqJson = jsonRequest("getStakeActivation", params);
+  return sendAsync<StakeActivation>(reqJson);
+}
+
+std::future<InflationGovernor> Connection::getInflationGovernorAsync(
+    const commitmentconfig &config) const {
+  const json params = {};
+  const json reqJson = jsonRequest("getInflationGovernor", params);
+  return sendAsync<InflationGovernor>(reqJson);
+}
+
+std::future<uint64_t> Connection::getTransactionCountAsync(
+    const GetSlotConfig &config) const {
+  const json params = {config};
+  const json reqJson = jsonRequest("getTransactionCount", params);
+  return sendAsync<uint64_t>(reqJson);
+}
+
+std::future<EpochInfo> Connection::getEpochInfoAsync(
+    const GetSlotConfig &config) const {
+  const json params = {config};
+  const json reqJson = jsonRequest("getEpochInfo", params);
+  return sendAsync<EpochInfo>(reqJson);
+}
+
+std::future<uint64_t> Connection::getMinimumBalanceForRentExemptionAsync(
+    const std::size_t dataLength, const commitmentconfig &config) const {
+  const json params = {dataLength, config};
+  const json reqJson = jsonRequest("getMinimumBalanceForRentExemption", params);
+  return sendAsync<uint64_t>(reqJson);
+}
+
+std::future<uint64_t> Connection::getBlockTimeAsync(const uint64_t slot) const {
+  const json params = {slot};
+  const json reqJson = jsonRequest("getBlockTime", params);
+  return sendAsync<uint64_t>(reqJson);
+}
+
+std::future<std::vector<Nodes>> Connection::getClusterNodesAsync() const {
+  const json params = {};
+  const json reqJson = jsonRequest("getClusterNodes", params);
+  return sendAsync<std::vector<Nodes>>(reqJson);
+}
+
+std::future<getFeeForMessageRes> Connection::getFeeForMessageAsync(
+    const std::string message, const GetSlotConfig &config) const {
+  const json params = {message, config};
+  const json reqJson = jsonRequest("getFeeForMessage", params);
+  return sendAsync<getFeeForMessageRes>(reqJson, [](const json &res) {
+    return res["value"].get<getFeeForMessageRes>();
+  });
+}
+
+std::future<std::vector<RecentPerformanceSamples>>
+Connection::getRecentPerformanceSamplesAsync(std::size_t limit) const {
+  const json params = {limit};
+  const auto reqJson = jsonRequest("getRecentPerformanceSamples", params);
+  return sendAsync<std::vector<RecentPerformanceSamples>>(reqJson);
+}
+
+std::future<RpcResponseAndContext<std::vector<LargestAccounts>>>
+Connection::getLargestAccountsAsync(const LargestAccountsConfig &config) const {
+  const json params = {config};
+  const auto reqJson = jsonRequest("getLargestAccounts", params);
+  return sendAsync<RpcResponseAndContext<std::vector<LargestAccounts>>>(
+      reqJson, contextAndValueFromResult<std::vector<LargestAccounts>>);
+}
+
+std::future<RpcResponseAndContext<std::optional<SignatureStatus>>>
+Connection::getSignatureStatusAsync(const std::string &signature,
+                                    bool searchTransactionHistory) const {
+  const json params = {
+      std::vector<std::string>{signature},
+      {{"searchTransactionHistory", searchTransactionHistory}}};
+  const auto reqJson = jsonRequest("getSignatureStatuses", params);
+  return sendAsync<RpcResponseAndContext<std::optional<SignatureStatus>>>(
+      reqJson, [](const json &res) {
+        const auto statuses = signatureStatusesFromResult(res);
+        return RpcResponseAndContext<std::optional<SignatureStatus>>{
+            statuses.context, statuses.value[0]};
+      });
+}
+
+std::future<std::vector<std::string>> Connection::getSlotLeadersAsync(
+    uint64_t startSlot, uint64_t limit) const {
+  const json params = {startSlot, limit};
+  const json reqJson = jsonRequest("getSlotLeaders", params);
+  return sendAsync<std::vector<std::string>>(reqJson);
+}
+
+std::future<RpcResponseAndContext<Supply>> Connection::getSupplyAsync(
+    const GetSupplyConfig &config) const {
+  const json params = {config};
+  const auto reqJson = jsonRequest("getSupply", params);
+  return sendAsync<RpcResponseAndContext<Supply>>(
+      reqJson, contextAndValueFromResult<Supply>);
+}
+
+std::future<RpcResponseAndContext<TokenAccountBalance>>
+Connection::getTokenAccountBalanceAsync(const std::string pubkey,
+                                        const commitmentconfig &config) const {
+  const json params = {pubkey, config};
+  const auto reqJson = jsonRequest("getTokenAccountBalance", params);
+  return sendAsync<RpcResponseAndContext<TokenAccountBalance>>(
+      reqJson, contextAndValueFromResult<TokenAccountBalance>);
+}
+
+std::future<VoteAccounts> Connection::getVoteAccountsAsync(
+    const GetVoteAccountsConfig &config) const {
+  const json params = {config};
+  const auto reqJson = jsonRequest("getVoteAccounts", params);
+  return sendAsync<VoteAccounts>(reqJson);
+}
+
+std::future<std::vector<SignaturesAddress>>
+Connection::getSignaturesForAddressAsync(
+    std::string pubkey,
+    const GetSignatureAddressConfig &signatureaddressconfig) const {
+  const json params = {pubkey, signatureaddressconfig};
+  const auto reqJson = jsonRequest("getSignaturesForAddress", params);
+  return sendAsync<std::vector<SignaturesAddress>>(reqJson);
+}
+
+std::future<RpcResponseAndContext<std::vector<TokenLargestAccounts>>>
+Connection::getTokenLargestAccountsAsync(std::string pubkey,
+                                         const commitmentconfig &config) const {
+  const json params = {pubkey, config};
+  const auto reqJson = jsonRequest("getTokenLargestAccounts", params);
+  return sendAsync<RpcResponseAndContext<std::vector<TokenLargestAccounts>>>(
+      reqJson, contextAndValueFromResult<std::vector<TokenLargestAccounts>>);
+}
+
+std::future<std::vector<uint64_t>> Connection::getBlocksAsync(
+    uint64_t start_slot, uint64_t end_slot,
+    const commitmentconfig &config) const {
+  const json params = {start_slot, end_slot, config};
+  const json reqJson = jsonRequest("getBlocks", params);
+  return sendAsync<std::vector<uint64_t>>(reqJson);
+}
+
+std::future<TokenSupply> Connection::getTokenSupplyAsync(
+    std::string pubkey) const {
+  const json params = {pubkey};
+  const auto reqJson = jsonRequest("getTokenSupply", params);
+  return sendAsync<TokenSupply>(reqJson, [](const json &res) {
+    return res["value"].get<TokenSupply>();
+  });
+}
+
+std::future<BlockProduction> Connection::getBlockProductionAsync(
+    const BlockProductionConfig &config) const {
+  const json params = {config};
+  const auto reqJson = jsonRequest("getBlockProduction", params);
+  return sendAsync<BlockProduction>(reqJson, [](const json &res) {
+    return res["value"].get<BlockProduction>();
+  });
+}
+
+std::future<std::vector<std::pair<std::string, std::vector<uint64_t>>>>
+Connection::getLeaderScheduleAsync(const std::optional<uint64_t> slot,
+                                   const GetSlotConfig &config) const {
+  json params;
+  if (slot.has_value()) {
+    params = {slot.value(), config};
+  } else {
+    params = {config};
+  }
+  const auto reqJson = jsonRequest("getLeaderSchedule", params);
+  return sendAsync<std::vector<std::pair<std::string, std::vector<uint64_t>>>>(
+      reqJson, leaderScheduleFromResult);
+}
+
+std::future<RpcResponseAndContext<std::vector<TokenAccountsByOwner>>>
+Connection::getTokenAccountsByOwnerAsync(
+    std::string pubkey, const mintOrProgramIdConfig &mPconfig,
+    const TokenAccountsByOwnerConfig &config) const {
+  const json params = {pubkey, mPconfig, config};
+  const auto reqJson = jsonRequest("getTokenAccountsByOwner", params);
+  return sendAsync<RpcResponseAndContext<std::vector<TokenAccountsByOwner>>>(
+      reqJson, contextAndValueFromResult<std::vector<TokenAccountsByOwner>>);
+}
+
+
+///
+/// BatchRequest
+BatchRequest::BatchRequest(const Connection &connection)
+    : connection_(connection) {}
+
+std::future<Blockhash> BatchRequest::getLatestBlockhash(
+    const Commitment &commitment) {
+  const json params = {{{"commitment", commitment}}};
+  return add<Blockhash>("getLatestBlockhash", params, blockhashFromResult);
+}
+
+std::future<uint64_t> BatchRequest::getBlockHeight(
+    const Commitment &commitment) {
+  const json params = {{{"commitment", commitment}}};
+  return add<uint64_t>("getBlockHeight", params);
+}
+
+std::future<uint64_t> BatchRequest::getSlot(const GetSlotConfig &config) {
+  const json params = {config};
+  return add<uint64_t>("getSlot", params);
+}
+
+std::future<uint64_t> BatchRequest::getBalance(const PublicKey &pubkey) {
+  const json params = {pubkey.toBase58()};
+  return add<uint64_t>("getBalance", params, [](const json &res) {
+    return res["value"].get<uint64_t>();
+  });
+}
+
+std::future<RpcResponseAndContext<std::vector<std::optional<SignatureStatus>>>>
+BatchRequest::getSignatureStatuses(const std::vector<std::string> &signatures,
+                                   bool searchTransactionHistory) {
+  const json params = {
+      signatures, {{"searchTransactionHistory", searchTransactionHistory}}};
+  return add<
+      RpcResponseAndContext<std::vector<std::optional<SignatureStatus>>>>(
+      "getSignatureStatuses", params, signatureStatusesFromResult);
+}
+
+void BatchRequest::send() {
+  if (handlers_.empty()) return;
+  // reset the batch before fulfilling any future
+  const json requests = std::move(requests_);
+  auto handlers = std::move(handlers_);
+  requests_ = json::array();
+  handlers_.clear();
+
+  json responses;
+  try {
+    responses = connection_.sendJsonRpcBatch(requests);
+  } catch (...) {
+    for (const auto &handler : handlers) handler(std::current_exception(), {});
+    throw;
+  }
+
+  // responses may arrive in any order, route them by id
+  for (const json &response : responses) {
+    if (!response.contains("id") || !response["id"].is_number_unsigned())
+      continue;
+    const auto id = response["id"].get<size_t>();
+    if (id >= handlers.size() || !handlers[id]) continue;
+    auto handler = std::move(handlers[id]);
+    handlers[id] = nullptr;
+    if (response.contains("error")) {
+      handler(std::make_exception_ptr(
+                  std::runtime_error(response["error"].dump())),
+              {});
+    } else if (!response.contains("result")) {
+      handler(std::make_exception_ptr(std::runtime_error(
+                  "missing result for request id " + std::to_string(id))),
+              {});
+    } else {
+      handler(nullptr, response["result"]);
+    }
+  }
+
+  // requests the node didn't answer
+  for (size_t id = 0; id < handlers.size(); id++) {
+    if (!handlers[id]) continue;
+    handlers[id](std::make_exception_ptr(std::runtime_error(
+                     "missing response for request id " + std::to_string(id))),
+                 {});
+  }
 }
 
 namespace subscription {
@@ -1075,19 +2001,74 @@ json accountSubscribeRequest(const std::string &account,
   return rpc::jsonRequest("accountSubscribe", params);
 }
 
+/**
+ * Split a websocket url, the port defaults to 80 for ws:// and 443 for wss://
+ * and the target to /
+ */
+WebSocketUrl parseWebSocketUrl(const std::string &url) {
+  WebSocketUrl parsed;
+  const auto schemeEnd = url.find("://");
+  const auto scheme =
+      schemeEnd == std::string::npos ? "" : url.substr(0, schemeEnd);
+  if (scheme == "wss") {
+    parsed.tls = true;
+  } else if (scheme == "ws") {
+    parsed.tls = false;
+  } else {
+    throw std::runtime_error("not a ws:// or wss:// url: " + url);
+  }
+  const auto authorityBegin = schemeEnd + 3;
+  const auto targetBegin = url.find('/', authorityBegin);
+  const auto authority =
+      url.substr(authorityBegin, targetBegin - authorityBegin);
+  parsed.target =
+      targetBegin == std::string::npos ? "/" : url.substr(targetBegin);
+  const auto portBegin = authority.find(':');
+  parsed.host = authority.substr(0, portBegin);
+  parsed.port = portBegin == std::string::npos
+                    ? (parsed.tls ? "443" : "80")
+                    : authority.substr(portBegin + 1);
+  if (parsed.host.empty()) throw std::runtime_error("missing host: " + url);
+  return parsed;
+}
+
 WebSocketSubscriber::WebSocketSubscriber(const std::string &host,
                                          const std::string &port,
-                                         int timeout_in_seconds) {
+                                         int timeout_in_seconds,
+                                         ReconnectPolicy reconnect_policy,
+                                         DispatchOptions dispatch_options) {
+  connect({false, host, port, "/"}, timeout_in_seconds, reconnect_policy,
+          nullptr, dispatch_options);
+}
+
+WebSocketSubscriber::WebSocketSubscriber(
+    const std::string &url, int timeout_in_seconds,
+    ReconnectPolicy reconnect_policy,
+    std::shared_ptr<ssl::context> ssl_context,
+    DispatchOptions dispatch_options) {
+  const auto parsed = parseWebSocketUrl(url);
+  if (parsed.tls && !ssl_context) ssl_context = default_ssl_context();
+  connect(parsed, timeout_in_seconds, reconnect_policy,
+          parsed.tls ? std::move(ssl_context) : nullptr, dispatch_options);
+}
+
+/// @brief start the io thread and wait for the first handshake
+void WebSocketSubscriber::connect(const WebSocketUrl &url,
+                                  int timeout_in_seconds,
+                                  ReconnectPolicy reconnect_policy,
+                                  std::shared_ptr<ssl::context> ssl_context,
+                                  DispatchOptions dispatch_options) {
   std::promise<void> handshake_promise;
   std::future<void> hanshake_future = handshake_promise.get_future();
   // create a new session
   sess = std::make_shared<session>(
       ioc, timeout_in_seconds,
-      std::make_unique<std::promise<void>>(std::move(handshake_promise)));
-  std::cout << host << ":" << port << std::endl;
+      std::make_unique<std::promise<void>>(std::move(handshake_promise)),
+      reconnect_policy, std::move(ssl_context), dispatch_options);
+  std::cout << url.host << ":" << url.port << std::endl;
   // function to read
   auto read_fn = [=]() {
-    sess->run(host, port);
+    sess->run(url.host, url.port, url.target);
     ioc.run();
   };
 
@@ -1095,16 +2076,32 @@ WebSocketSubscriber::WebSocketSubscriber(const std::string &host,
   read_thread = std::thread(read_fn);
   if (hanshake_future.wait_for(std::chrono::seconds(timeout_in_seconds)) ==
       std::future_status::timeout) {
-    std::cerr << "Timeout waiting for subscription request on " << host << ":"
-              << port << std::endl;
+    std::cerr << "Timeout waiting for subscription request on " << url.host
+              << ":" << url.port << std::endl;
   }
 }
+
 WebSocketSubscriber::~WebSocketSubscriber() {
   // disconnect the session and wait for the threads to complete
   sess->disconnect();
   if (read_thread.joinable()) read_thread.join();
 }
 
+/// @brief callback to call for every subscription restored after a
+/// reconnect, with the slot of its last notification before the drop
+/// @param on_gap callback to call
+void WebSocketSubscriber::onGap(GapCallback on_gap) {
+  sess->set_gap_callback(std::move(on_gap));
+}
+
+/// @brief counters of the dispatch pool, all zero without workers
+DispatchStats WebSocketSubscriber::dispatchStats() const {
+  return sess->dispatch_stats();
+}
+
+/// @brief connection state and counters of the session
+SessionHealth WebSocketSubscriber::health() const { return sess->health(); }
+
 /// @brief callback to call when data in account changes
 /// @param pub_key public key for the account
 /// @param account_change_callback callback to call when the data changes
@@ -1115,28 +2112,270 @@ int WebSocketSubscriber::onAccountChange(const solana::PublicKey &pub_key,
                                          const Commitment &commitment,
                                          Callback on_subscibe,
                                          Callback on_unsubscribe) {
-  // create parameters using the user provided input
-  json param = {pub_key, {{"encoding", "base64"}, {"commitment", commitment}}};
+  return subscribe("accountSubscribe", "accountUnsubscribe",
+                   accountSubscribeParams(pub_key, commitment),
+                   account_change_callback, nullptr, on_subscibe,
+                   on_unsubscribe);
+}
+
+/// @brief params of an accountSubscribe request
+json WebSocketSubscriber::accountSubscribeParams(
+    const solana::PublicKey &pub_key, const Commitment &commitment) {
+  return {pub_key, {{"encoding", "base64"}, {"commitment", commitment}}};
+}
+
+/// @brief callback to call for every slot the validator processed
+/// @param slot_change_callback callback to call with the slot
+/// @return subsccription id (actually the current id)
+int WebSocketSubscriber::onSlotChange(
+    std::function<void(const SlotInfo &)> slot_change_callback,
+    Callback on_subscibe, Callback on_unsubscribe) {
+  auto info = std::make_shared<SlotInfo>();
+  RawCallback raw_cb = [info, cb = std::move(slot_change_callback)](
+                           std::string_view notification) {
+    decodeSlotNotification(notification, *info);
+    cb(*info);
+  };
+  return subscribe("slotSubscribe", "slotUnsubscribe", json::array(), nullptr,
+                   std::move(raw_cb), on_subscibe, on_unsubscribe);
+}
+
+/// @brief callback to call once the transaction reached commitment, the
+/// server ends the subscription after that
+/// @param signature base58 encoded transaction signature
+/// @param signature_callback callback to call with the outcome and the slot
+/// of the notification
+/// @param commitment commitment
+/// @return subsccription id (actually the current id)
+int WebSocketSubscriber::onSignature(
+    const std::string &signature,
+    std::function<void(const SignatureResult &, uint64_t)> signature_callback,
+    const Commitment &commitment, Callback on_subscibe,
+    Callback on_unsubscribe) {
+  RawCallback raw_cb = [cb = std::move(signature_callback)](
+                           std::string_view notification) {
+    SignatureResult result;
+    const auto slot = decodeSignatureNotification(notification, result);
+    cb(result, slot);
+  };
+  return subscribe("signatureSubscribe", "signatureUnsubscribe",
+                   {signature, {{"commitment", commitment}}}, nullptr,
+                   std::move(raw_cb), on_subscibe, on_unsubscribe, true);
+}
+
+/// @brief params of a programSubscribe request
+json WebSocketSubscriber::programSubscribeParams(
+    const solana::PublicKey &program_id, const ProgramAccountFilters &filters,
+    const Commitment &commitment) {
+  return {program_id,
+          {{"encoding", "base64"},
+           {"commitment", commitment},
+           {"filters", filters}}};
+}
+
+/// @brief callback to call with the logs of every transaction mentioning
+/// an account
+/// @param mentions public key the transactions mention
+/// @param logs_callback callback to call with the logs and the slot of the
+/// notification
+/// @param commitment commitment
+/// @return subsccription id (actually the current id)
+int WebSocketSubscriber::onLogs(
+    const solana::PublicKey &mentions,
+    std::function<void(const Logs &, uint64_t)> logs_callback,
+    const Commitment &commitment, Callback on_subscibe,
+    Callback on_unsubscribe) {
+  return logsSubscribe({{"mentions", {mentions}}}, std::move(logs_callback),
+                       commitment, on_subscibe, on_unsubscribe);
+}
+
+/// @brief callback to call with the logs of every transaction
+/// @param filter whether vote transactions are included
+/// @param logs_callback callback to call with the logs and the slot of the
+/// notification
+/// @param commitment commitment
+/// @return subsccription id (actually the current id)
+int WebSocketSubscriber::onLogs(
+    LogsFilter filter,
+    std::function<void(const Logs &, uint64_t)> logs_callback,
+    const Commitment &commitment, Callback on_subscibe,
+    Callback on_unsubscribe) {
+  return logsSubscribe(filter, std::move(logs_callback), commitment,
+                       on_subscibe, on_unsubscribe);
+}
+
+/// @brief subscribe to logsSubscribe with the given filter
+int WebSocketSubscriber::logsSubscribe(
+    json &&filter, std::function<void(const Logs &, uint64_t)> logs_callback,
+    const Commitment &commitment, Callback on_subscibe,
+    Callback on_unsubscribe) {
+  auto logs = std::make_shared<Logs>();
+  RawCallback raw_cb = [logs, cb = std::move(logs_callback)](
+                           std::string_view notification) {
+    const auto slot = decodeLogsNotification(notification, *logs);
+    cb(*logs, slot);
+  };
+  return subscribe("logsSubscribe", "logsUnsubscribe",
+                   {std::move(filter), {{"commitment", commitment}}}, nullptr,
+                   std::move(raw_cb), on_subscibe, on_unsubscribe);
+}
 
+/// @brief callback to call whenever the validator sets a new root
+/// @param root_change_callback callback to call with the root slot
+/// @return subsccription id (actually the current id)
+int WebSocketSubscriber::onRootChange(
+    std::function<void(uint64_t)> root_change_callback, Callback on_subscibe,
+    Callback on_unsubscribe) {
+  RawCallback raw_cb = [cb = std::move(root_change_callback)](
+                           std::string_view notification) {
+    cb(decodeRootNotification(notification));
+  };
+  return subscribe("rootSubscribe", "rootUnsubscribe", json::array(), nullptr,
+                   std::move(raw_cb), on_subscibe, on_unsubscribe);
+}
+
+/// @brief send a subscription request with the current id
+/// @param one_shot the server ends the subscription after its first
+/// notification
+/// @return subsccription id (actually the current id)
+int WebSocketSubscriber::subscribe(const std::string &subscribe_method,
+                                   const std::string &unsubscribe_method,
+                                   json &&params, Callback cb,
+                                   RawCallback raw_cb, Callback on_subscibe,
+                                   Callback on_unsubscribe, bool one_shot) {
+  // reserve the id and id + 1 of the unsubscription, subscribe may be called
+  // from several threads
+  const auto id = curr_id.fetch_add(2);
   // create a new request content
-  RequestContent req(curr_id, "accountSubscribe", "accountUnsubscribe",
-                     account_change_callback, std::move(param), on_subscibe,
-                     on_unsubscribe);
+  RequestContent req(id, subscribe_method, unsubscribe_method, cb,
+                     std::move(params), on_subscibe, on_unsubscribe);
+  req.raw_cb = std::move(raw_cb);
+  req.one_shot = one_shot;
 
-  // subscribe the new request content
+  // subscribe the new request content, it is written on the io thread
   sess->subscribe(req);
 
-  // increase the curr_id so that it can be used for the next request content
-  curr_id += 2;
-
   return req.id;
 }
 
 /// @brief remove the account change listener for the given id
 /// @param sub_id the id for which removing subscription is needed
 void WebSocketSubscriber::removeAccountChangeListener(RequestIdType sub_id) {
+  removeListener(sub_id);
+}
+
+/// @brief remove any listener, works for the ids of all on* methods
+/// @param sub_id the id for which removing subscription is needed
+void WebSocketSubscriber::removeListener(RequestIdType sub_id) {
   sess->unsubscribe(sub_id);
 }
+
+/**
+ * Shard of an account among shards, a jump consistent hash of the public key.
+ * Keys are spread evenly and going from n to n + 1 shards only moves the keys
+ * that the new shard takes over
+ */
+size_t shardOf(const PublicKey &pub_key, size_t shards) {
+  // Lamping and Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm".
+  // Public keys are uniform already, their first bytes seed the generator
+  uint64_t key = PublicKeyHash()(pub_key);
+  int64_t shard = -1;
+  int64_t next = 0;
+  while (next < static_cast<int64_t>(shards)) {
+    shard = next;
+    key = key * 2862933555777941757ull + 1;
+    next = static_cast<int64_t>((shard + 1) *
+                                (double(1ll << 31) / double((key >> 33) + 1)));
+  }
+  return shard;
+}
+
+/// @brief connect shards subscribers to a ws:// or wss:// url, all options
+/// apply to every shard. The shards connect in parallel
+ShardedSubscriber::ShardedSubscriber(const std::string &url, size_t shards,
+                                     int timeout_in_seconds,
+                                     ReconnectPolicy reconnect_policy,
+                                     std::shared_ptr<ssl::context> ssl_context,
+                                     DispatchOptions dispatch_options) {
+  if (shards == 0) {
+    throw std::runtime_error("ShardedSubscriber needs at least one shard");
+  }
+  // every subscriber waits for its handshake, wait for all of them at once
+  std::vector<std::future<std::unique_ptr<WebSocketSubscriber>>> connecting;
+  for (size_t i = 0; i < shards; i++) {
+    connecting.push_back(std::async(std::launch::async, [&]() {
+      return std::make_unique<WebSocketSubscriber>(
+          url, timeout_in_seconds, reconnect_policy, ssl_context,
+          dispatch_options);
+    }));
+  }
+  for (auto &shard : connecting) shards_.push_back(shard.get());
+}
+
+/// @brief number of shards
+size_t ShardedSubscriber::size() const { return shards_.size(); }
+
+/// @brief callback to call for every subscription restored after a
+/// reconnect of its shard
+/// @param on_gap callback to call
+void ShardedSubscriber::onGap(GapCallback on_gap) {
+  const auto shards = shards_.size();
+  for (size_t shard = 0; shard < shards; shard++) {
+    shards_[shard]->onGap(
+        [shard, shards, on_gap](RequestIdType id, uint64_t last_slot) {
+          on_gap(shardedId(shard, shards, id), last_slot);
+        });
+  }
+}
+
+/// @brief see WebSocketSubscriber::onAccountChange
+int ShardedSubscriber::onAccountChange(const solana::PublicKey &pub_key,
+                                       Callback account_change_callback,
+                                       const Commitment &commitment,
+                                       Callback on_subscibe,
+                                       Callback on_unsubscribe) {
+  const auto shard = shardOf(pub_key, shards_.size());
+  return shardedId(shard, shards_.size(),
+                   shards_[shard]->onAccountChange(
+                       pub_key, account_change_callback, commitment,
+                       on_subscibe, on_unsubscribe));
+}
+
+/// @brief remove the account change listener for the given id
+/// @param sub_id the id returned by onAccountChange
+void ShardedSubscriber::removeAccountChangeListener(RequestIdType sub_id) {
+  const auto shard = sub_id % shards_.size();
+  shards_[shard]->removeAccountChangeListener(sub_id / shards_.size() * 2);
+}
+
+/// @brief health of every shard
+std::vector<SessionHealth> ShardedSubscriber::shardHealth() const {
+  std::vector<SessionHealth> health;
+  for (const auto &shard : shards_) health.push_back(shard->health());
+  return health;
+}
+
+/// @brief health summed over all shards, connected only if all shards are
+SessionHealth ShardedSubscriber::health() const {
+  SessionHealth total{true, 0, 0, 0, {0, 0, 0}};
+  for (const auto &shard : shardHealth()) {
+    total.connected = total.connected && shard.connected;
+    total.reconnects += shard.reconnects;
+    total.subscriptions += shard.subscriptions;
+    total.notifications += shard.notifications;
+    total.dispatch.pushed += shard.dispatch.pushed;
+    total.dispatch.dropped += shard.dispatch.dropped;
+    total.dispatch.conflated += shard.dispatch.conflated;
+  }
+  return total;
+}
+
+/// @brief the id of a shard's subscription, unique over all shards.
+/// Subscribers hand out even ids, the odd ones are for unsubscribing
+int ShardedSubscriber::shardedId(size_t shard, size_t shards,
+                                 RequestIdType id) {
+  return static_cast<int>(id / 2 * shards + shard);
+}
 }  // namespace subscription
 }  // namespace rpc
 }  // namespace solana
\ No newline at end of file
@@ -1,9 +1,59 @@
 #include "websocket.hpp"
 
 #include <nlohmann/json.hpp>
+#include <optional>
+
+#include "jsonScanner.hpp"
 
 using json = nlohmann::json;  // from <nlohmann/json.hpp>
 
+namespace {
+/// @brief the fields of a notification needed to route it
+struct NotificationHeader {
+  // subscription id, std::nullopt for responses to requests
+  std::optional<RequestIdType> subscription;
+  // slot of the notification's context, or of a slot notification
+  uint64_t slot = 0;
+};
+
+/// @brief read the header of a notification without parsing the
+/// notification's value, which can be large
+/// @param text the message recieved from websocket
+NotificationHeader notification_header(std::string_view text) {
+  NotificationHeader header;
+  solana::JsonScanner scanner(text);
+  const auto read_slot = [&](std::string_view key) {
+    if (key == "slot") {
+      header.slot = scanner.unsignedInteger();
+    } else {
+      scanner.skipValue();
+    }
+  };
+  scanner.object([&](std::string_view key) {
+    if (key != "params") {
+      scanner.skipValue();
+      return;
+    }
+    scanner.object([&](std::string_view key) {
+      if (key == "subscription") {
+        header.subscription = scanner.unsignedInteger();
+      } else if (key == "result" && scanner.peek() == '{') {
+        scanner.object([&](std::string_view key) {
+          if (key == "context") {
+            scanner.object(read_slot);
+          } else {
+            read_slot(key);
+          }
+        });
+      } else {
+        scanner.skipValue();
+      }
+    });
+  });
+  return header;
+}
+}  // namespace
+
 /// @brief constructor
 RequestContent::RequestContent(RequestIdType id, std::string subscribe_method,
                                std::string unsubscribe_method, Callback cb,
@@ -37,23 +87,73 @@ json RequestContent::get_unsubscription_request(
   return req;
 }
 
+/// @brief delay before a reconnection attempt, randomized between half and
+/// all of the backoff
+/// @param attempt number of failed attempts since the last connection
+/// @param rng source of the jitter
+std::chrono::milliseconds ReconnectPolicy::delay(unsigned attempt,
+                                                 std::mt19937 &rng) const {
+  auto backoff = initial_delay;
+  for (unsigned i = 0; i < attempt && backoff < max_delay; i++) backoff *= 2;
+  backoff = std::min(backoff, max_delay);
+  std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(
+      backoff.count() / 2, backoff.count());
+  return std::chrono::milliseconds(jitter(rng));
+}
+
+/// @brief tls client context verifying peers against the system's default
+/// certificate paths, created once and shared by all sessions using it
+std::shared_ptr<ssl::context> default_ssl_context() {
+  static const auto context = []() {
+    auto context = std::make_shared<ssl::context>(ssl::context::tls_client);
+    context->set_default_verify_paths();
+    context->set_verify_mode(ssl::verify_peer);
+    return context;
+  }();
+  return context;
+}
+
 /// @brief resolver and websocket require an io context to do io operations
 /// @param ioc
+/// @param ssl_context connect with wss:// using this context, plain ws://
+/// if nullptr. Can be shared between sessions
+/// @param dispatch_options run callbacks on a pool of workers instead of
+/// the io thread if dispatch_options.workers > 0
 session::session(net::io_context &ioc, int timeout_in_seconds,
-                 session::HandshakePromisePtr handshake_promise)
-    : resolver(net::make_strand(ioc)), ws(net::make_strand(ioc)),
-      connection_timeout(timeout_in_seconds),
-      handshake_promise(std::move(handshake_promise)) {
+                 session::HandshakePromisePtr handshake_promise,
+                 ReconnectPolicy reconnect_policy,
+                 std::shared_ptr<ssl::context> ssl_context,
+                 solana::DispatchOptions dispatch_options)
+    : handshake_promise(std::move(handshake_promise)),
+      strand(net::make_strand(ioc)), resolver(strand),
+      ssl_context(std::move(ssl_context)), reconnect_timer(strand),
+      reconnect_policy(reconnect_policy), rng(std::random_device{}()),
+      flush_timer(strand), connection_timeout(timeout_in_seconds) {
   is_connected.store(false);
+  is_closing.store(false);
+  dispatch_table.store(new DispatchTable());
+  if (dispatch_options.workers > 0) {
+    dispatch_pool = std::make_unique<solana::DispatchPool<Notification>>(
+        dispatch_options, [](Notification &notification) {
+          invoke(*notification.req, notification.text);
+          // release the request and the text on the worker
+          notification = {};
+        });
+  }
+  reset_stream();
 }
 
+session::~session() { delete dispatch_table.load(); }
+
 /// @brief Looks up the domain name to make connection to -> calls on_resolve
 /// @param host the host address
 /// @param port port number
-/// @param text ping message
-void session::run(std::string host, std::string port) {
-  // Save these for later
+/// @param target path of the websocket endpoint
+void session::run(std::string host, std::string port, std::string target) {
+  // Save these for later, reconnects resolve them again
   this->host = host;
+  this->port = port;
+  this->target = target;
   tcp::resolver::query resolver_query(host, port);
   // Look up the domain name
   resolver.async_resolve(
@@ -64,50 +164,79 @@ void session::run(std::string host, std::string port) {
 /// @brief push a function for subscription
 /// @param req the request to call
 void session::subscribe(const RequestContent &req) {
-  // context for unique_lock
-  {
-    std::unique_lock lk(mutex_for_maps);
-    callback_map[req.id] = req;
-  }
-  // get subscription request and then send it to the websocket
-  ws.write(net::buffer(req.get_subscription_request().dump()));
+  auto request = std::make_shared<RequestContent>(req);
+  net::post(strand, [self = shared_from_this(), request]() {
+    self->callback_map[request->id] = request;
+    // while disconnected the request is sent once the connection is back
+    if (!self->is_connected.load()) return;
+    self->send(request->get_subscription_request().dump());
+  });
 }
 
 /// @brief push for unsubscription
 /// @param id the id to unsubscribe on
 void session::unsubscribe(RequestIdType id) {
-  // context for shared lock
-  std::string unsubsciption_request = "";
-  {
-    std::shared_lock lk(mutex_for_maps);
-
-    auto ite = callback_map.find(id);
-    if (ite == callback_map.end()) return;
-    unsubsciption_request =
-        ite->second.get_unsubscription_request(ite->second.ws_id).dump();
-    maps_wsid_to_id.erase(ite->second.ws_id);
-  }
-  if (!unsubsciption_request.empty()) {
-    // write it to the websocket
-    ws.write(net::buffer(unsubsciption_request));
-  }
+  net::post(strand, [self = shared_from_this(), id]() {
+    const auto ite = self->callback_map.find(id);
+    if (ite == self->callback_map.end() || ite->second->unsubscribing) return;
+    auto &req = *ite->second;
+    req.unsubscribing = true;
+    // without a subscription id yet, the request is sent with the response
+    if (!req.subscribed) return;
+    self->maps_wsid_to_id.erase(req.ws_id);
+    self->publish_dispatch_table();
+    // while disconnected the server forgot the subscription already
+    if (!self->is_connected.load()) return;
+    self->send(req.get_unsubscription_request(req.ws_id).dump());
+  });
 }
 
-/// @brief disconnect from browser
+/// @brief disconnect from browser, no reconnection is attempted afterwards
 void session::disconnect() {
   // set is connected to false to close the read and write thread
+  is_closing.store(true);
   is_connected.store(false);
 
-  // Close the WebSocket connection
-  ws.async_close(
-      websocket::close_code::normal,
-      beast::bind_front_handler(&session::on_close, shared_from_this()));
+  net::post(strand, [self = shared_from_this()]() {
+    // stop a pending reconnection attempt
+    self->reconnect_timer.cancel();
+    self->flush_timer.cancel();
+    self->resolver.cancel();
+    // frames queued before, like unsubscriptions, are written first
+    if (self->writing) {
+      self->close_pending = true;
+      return;
+    }
+    self->close_stream();
+  });
+}
+
+/// @brief set the callback called for every subscription restored after a
+/// reconnect
+/// @param on_gap the callback
+void session::set_gap_callback(GapCallback on_gap) {
+  net::post(strand, [self = shared_from_this(), on_gap = std::move(on_gap)]() {
+    self->on_gap = on_gap;
+  });
 }
 
 /// @brief check if connection has been stablished
 /// @return if connection has been established
 bool session::connection_established() { return is_connected.load(); }
 
+/// @brief counters of the dispatch pool, all zero without workers
+solana::DispatchStats session::dispatch_stats() const {
+  if (!dispatch_pool) return {};
+  return dispatch_pool->stats();
+}
+
+/// @brief connection state and counters of the session
+SessionHealth session::health() const {
+  return {is_connected.load(), reconnects.load(std::memory_order_relaxed),
+          confirmed_subscriptions.load(std::memory_order_relaxed),
+          notifications.load(std::memory_order_relaxed), dispatch_stats()};
+}
+
 /// @brief log error messages
 /// @param ec the error code recieved from websocket
 /// @param what a text to log with error
@@ -115,67 +244,234 @@ void session::fail(beast::error_code ec, char const *what) {
   std::cerr << what << ": " << ec.message() << "\n";
 }
 
+/// @brief log the error and retry connecting after a backoff, unless
+/// disconnect was called
+/// @param ec the error code recieved from websocket
+/// @param what a text to log with error
+void session::reconnect(beast::error_code ec, char const *what) {
+  if (is_closing.load()) return;
+  fail(ec, what);
+  // only count lost connections, not failed attempts to reconnect
+  if (is_connected.exchange(false)) {
+    reconnects.fetch_add(1, std::memory_order_relaxed);
+  }
+  // abort a pending write, its frames are replayed from the maps
+  with_stream([](auto &ws) { beast::get_lowest_layer(ws).close(); });
+
+  const auto delay = reconnect_policy.delay(reconnect_attempt++, rng);
+  std::cerr << "reconnecting in " << delay.count() << "ms\n";
+  reconnect_timer.expires_after(delay);
+  reconnect_timer.async_wait(beast::bind_front_handler(
+      &session::on_reconnect_timer, shared_from_this()));
+}
+
+/// @brief start a new connection once the backoff elapsed -> calls
+/// on_resolve
+/// @param ec error code of the timer, set if cancelled by disconnect
+void session::on_reconnect_timer(beast::error_code ec) {
+  if (ec || is_closing.load()) return;
+
+  // the aborted write still uses the stream, wait for its handler
+  if (writing) {
+    reconnect_timer.expires_after(std::chrono::milliseconds(1));
+    reconnect_timer.async_wait(beast::bind_front_handler(
+        &session::on_reconnect_timer, shared_from_this()));
+    return;
+  }
+
+  // a websocket stream can't be reopened, start over with a new one
+  reset_stream();
+  buffer.clear();
+
+  tcp::resolver::query resolver_query(host, port);
+  resolver.async_resolve(
+      resolver_query,
+      beast::bind_front_handler(&session::on_resolve, shared_from_this()));
+}
+
+/// @brief replay all subscriptions on a new connection
+void session::resubscribe() {
+  // the server ids of the old connection are gone
+  maps_wsid_to_id.clear();
+  for (auto ite = callback_map.begin(); ite != callback_map.end();) {
+    auto &req = *ite->second;
+    if (req.unsubscribing) {
+      last_slots.erase(req.id);
+      ite = callback_map.erase(ite);
+      continue;
+    }
+    req.resubscribing = req.subscribed;
+    req.subscribed = false;
+    send(req.get_subscription_request().dump());
+    ++ite;
+  }
+  publish_dispatch_table();
+}
+
+/// @brief queue a frame and start writing it unless a write is in progress
+/// @param frame the text to write
+void session::send(std::string frame) {
+  write_queue.push_back(std::move(frame));
+  if (!writing) do_write();
+}
+
+/// @brief write the frame in front of the queue -> calls on_write
+void session::do_write() {
+  writing = true;
+  with_stream([&](auto &ws) {
+    ws.async_write(
+        net::buffer(write_queue.front()),
+        beast::bind_front_handler(&session::on_write, shared_from_this()));
+  });
+}
+
+/// @brief write the next frame, or close if disconnect was called meanwhile
+/// @param ec error code while writing
+/// @param bytes_transferred Amount of byte written
+void session::on_write(beast::error_code ec, std::size_t bytes_transferred) {
+  boost::ignore_unused(bytes_transferred);
+  writing = false;
+  if (ec) {
+    // the frames are replayed from the maps on the next connection. Closing
+    // the socket fails the pending read, which reconnects
+    write_queue.clear();
+    if (is_connected.load()) {
+      fail(ec, "write");
+      with_stream([](auto &ws) { beast::get_lowest_layer(ws).close(); });
+    }
+  } else {
+    write_queue.pop_front();
+    if (!write_queue.empty()) return do_write();
+  }
+  if (close_pending) {
+    close_pending = false;
+    close_stream();
+  }
+}
+
+/// @brief close the websocket, or just the socket if it isn't open
+void session::close_stream() {
+  with_stream([&](auto &ws) {
+    if (!ws.is_open()) {
+      beast::get_lowest_layer(ws).close();
+      return;
+    }
+    // Close the WebSocket connection
+    ws.async_close(websocket::close_code::normal,
+                   beast::bind_front_handler(&session::on_close,
+                                             shared_from_this()));
+  });
+}
+
+/// @brief create a fresh websocket stream, plain or tls
+void session::reset_stream() {
+  if (ssl_context) {
+    wss.emplace(strand, *ssl_context);
+  } else {
+    ws.emplace(strand);
+  }
+}
+
 /// @brief Used to connect to the provided host -> calls on_connect
 /// @param ec error code in case of the resolve
 /// @param results the result of the resolve
 void session::on_resolve(beast::error_code ec,
                          tcp::resolver::results_type results) {
-  if (ec) return fail(ec, "resolve");
-
-  // Set the timeout for the operation
-  beast::get_lowest_layer(ws).expires_after(
-      std::chrono::seconds(connection_timeout));
-
-  // Make the connection on the IP address we get from a lookup
-  beast::get_lowest_layer(ws).async_connect(
-      results,
-      beast::bind_front_handler(&session::on_connect, shared_from_this()));
+  if (ec) return reconnect(ec, "resolve");
+
+  with_stream([&](auto &ws) {
+    // Set the timeout for the operation
+    beast::get_lowest_layer(ws).expires_after(
+        std::chrono::seconds(connection_timeout));
+
+    // Make the connection on the IP address we get from a lookup
+    beast::get_lowest_layer(ws).async_connect(
+        results,
+        beast::bind_front_handler(&session::on_connect, shared_from_this()));
+  });
 }
 
-/// @brief Initiates handshake for the websocket connection -> calls
-/// on_handshake
+/// @brief Initiates the tls handshake, or the websocket handshake on plain
+/// connections
 /// @param ec the error code during connect
 /// @param
 void session::on_connect(beast::error_code ec,
                          tcp::resolver::results_type::endpoint_type) {
-  if (ec) return fail(ec, "connect");
-
-  // Turn off the timeout on the tcp_stream, because
-  // the websocket stream has its own timeout system.
-  beast::get_lowest_layer(ws).expires_never();
+  if (ec) return reconnect(ec, "connect");
+  if (!wss) return websocket_handshake();
+
+  // servers hosting several names pick the certificate by SNI
+  auto &tls = wss->next_layer();
+  if (!SSL_set_tlsext_host_name(tls.native_handle(), host.c_str())) {
+    return reconnect(beast::error_code(static_cast<int>(::ERR_get_error()),
+                                       net::error::get_ssl_category()),
+                     "sni");
+  }
+  tls.set_verify_callback(ssl::host_name_verification(host));
 
-  // Set suggested timeout settings for the websocket
-  ws.set_option(
-      websocket::stream_base::timeout::suggested(beast::role_type::client));
+  tls.async_handshake(
+      ssl::stream_base::client,
+      beast::bind_front_handler(&session::on_tls_handshake,
+                                shared_from_this()));
+}
 
-  // Set a decorator to change the User-Agent of the handshake
-  ws.set_option(
-      websocket::stream_base::decorator([](websocket::request_type &req) {
-        req.set(http::field::user_agent,
-                std::string(BOOST_BEAST_VERSION_STRING) +
-                    " websocket-client-async");
-      }));
+/// @brief Initiates the websocket handshake once tls is up
+/// @param ec the error code during the tls handshake
+void session::on_tls_handshake(beast::error_code ec) {
+  if (ec) return reconnect(ec, "tls handshake");
+  websocket_handshake();
+}
 
-  // Perform the websocket handshake
-  ws.async_handshake(
-      host, "/",
-      beast::bind_front_handler(&session::on_handshake, shared_from_this()));
+/// @brief Initiates handshake for the websocket connection -> calls
+/// on_handshake
+void session::websocket_handshake() {
+  with_stream([&](auto &ws) {
+    // Turn off the timeout on the tcp_stream, because
+    // the websocket stream has its own timeout system.
+    beast::get_lowest_layer(ws).expires_never();
+
+    // Set suggested timeout settings for the websocket
+    ws.set_option(
+        websocket::stream_base::timeout::suggested(beast::role_type::client));
+
+    // Set a decorator to change the User-Agent of the handshake
+    ws.set_option(
+        websocket::stream_base::decorator([](websocket::request_type &req) {
+          req.set(http::field::user_agent,
+                  std::string(BOOST_BEAST_VERSION_STRING) +
+                      " websocket-client-async");
+        }));
+
+    // Perform the websocket handshake
+    ws.async_handshake(host, target,
+                       beast::bind_front_handler(&session::on_handshake,
+                                                 shared_from_this()));
+  });
 }
 
 /// @brief Send the ping message once the handshake has been complete calls ->
 /// on_read
 /// @param ec error code on handshake
 void session::on_handshake(beast::error_code ec) {
-  if (ec) return fail(ec, "handshake");
+  if (ec) return reconnect(ec, "handshake");
+  reconnect_attempt = 0;
 
+  // subscribe and unsubscribe run on the strand as well, so every request
+  // is sent exactly once
+  resubscribe();
   // If you reach here connection is up set is_connected to true
   is_connected.store(true);
 
-  if (handshake_promise) handshake_promise->set_value();
+  if (handshake_promise) {
+    handshake_promise->set_value();
+    handshake_promise.reset();
+  }
 
   // Start listening to the socket for messages
-  ws.async_read(
-      buffer, beast::bind_front_handler(&session::on_read, shared_from_this()));
+  with_stream([&](auto &ws) {
+    ws.async_read(buffer, beast::bind_front_handler(&session::on_read,
+                                                    shared_from_this()));
+  });
 }
 
 /// @brief Deals with the message recieved from server, calls itself to keep
@@ -184,9 +480,9 @@ void session::on_handshake(beast::error_code ec) {
 /// @param bytes_transferred Amount of byte recieved
 void session::on_read(beast::error_code ec, std::size_t bytes_transferred) {
   boost::ignore_unused(bytes_transferred);
-  // report error on read
+  // the connection dropped, reconnect unless disconnect was called
   if (ec) {
-    return fail(ec, "read");
+    return reconnect(ec, "read");
   }
 
   // id socket has been disconnected then return
@@ -194,57 +490,22 @@ void session::on_read(beast::error_code ec, std::size_t bytes_transferred) {
     return;
   }
 
-  // get the data from the websocket and parse it to json
-  auto res = buffer.data();
-  json data = json::parse(net::buffers_begin(res), net::buffers_end(res));
+  // notifications are routed by their header only, the callback decides how
+  // to parse the rest
+  const auto res = buffer.data();
+  const std::string_view text(static_cast<const char *>(res.data()),
+                              res.size());
 
-  // if data contains field result then it's either subscription or
-  // unsubscription response
-  static const char *result = "result";
   try {
-    if (data.contains(std::string{result})) {
-      RequestIdType id = data["id"];
-      // if the result field is boolean than it's an unsubscription request
-      // could be ignored
-      if (data[result].is_boolean()) {
-        // usually this means that we are unsubscribing
-        Callback on_unsubscribe = nullptr;
-        id--;
-        // context for lock
-        {
-          std::unique_lock lk(mutex_for_maps);
-          const auto ite = callback_map.find(id);
-          if (ite != callback_map.end()) {
-            on_unsubscribe = ite->second.on_unsubscribe;
-            callback_map.erase(ite);
-          }
-        }
-        if (on_unsubscribe) {
-          on_unsubscribe(data);
-        }
-      } else {
-        // usually this means that our subscription request has been successfull
-        // context for lock
-        Callback on_subscribe = nullptr;
-        {
-          std::unique_lock lk(mutex_for_maps);
-
-          const auto ite = callback_map.find(id);
-          if (ite != callback_map.end()) {
-            on_subscribe = ite->second.on_subscribe;
-            ite->second.subscribed = true;
-            ite->second.ws_id = data[result];
-            maps_wsid_to_id[ite->second.ws_id] = id;
-          }
-        }
-        if (on_subscribe) {
-          on_subscribe(data);
-        }
-      }
-    }
+    const auto header = notification_header(text);
     // it's a notification process it sccordingly
-    else {
-      call_callback(data);
+    if (header.subscription) {
+      call_callback(*header.subscription, header.slot, text);
+    } else {
+      // if data contains field result then it's either subscription or
+      // unsubscription response
+      const json data = json::parse(text);
+      if (data.contains("result")) on_response(data);
     }
   } catch (...) {
     // catch any exception so that we still continue reading
@@ -255,51 +516,127 @@ void session::on_read(beast::error_code ec, std::size_t bytes_transferred) {
   buffer.consume(bytes_transferred);
 
   // call read again to read continiously
-  ws.async_read(
-      buffer, beast::bind_front_handler(&session::on_read, shared_from_this()));
+  with_stream([&](auto &ws) {
+    ws.async_read(buffer, beast::bind_front_handler(&session::on_read,
+                                                    shared_from_this()));
+  });
 }
 
-/// @brief close the connection from websocket
-/// @param ec the error code
-Callback session::get_callback(RequestIdType request_id) {
-  std::shared_lock lk(mutex_for_maps);
-  auto id_ite = maps_wsid_to_id.find(request_id);
-  if (id_ite == maps_wsid_to_id.end()) {
-    // we have already unsubscribed so no need to call the callback
-    return nullptr;
-  }
-  RequestIdType id = id_ite->second;
-  auto sub_ite = callback_map.find(id);
-  if (sub_ite == callback_map.end()) {
-    std::cerr << "subscription found but request not found " << request_id
-              << std::endl;
-    return nullptr;
+/// @brief handle the response to a subscription or unsubscription request
+/// @param data the response recieved from websocket
+void session::on_response(const json &data) {
+  static const char *result = "result";
+  RequestIdType id = data.at("id");
+  // if the result field is boolean than it's an unsubscription request
+  // could be ignored
+  if (data.at(result).is_boolean()) {
+    // usually this means that we are unsubscribing
+    id--;
+    const auto ite = callback_map.find(id);
+    if (ite == callback_map.end()) return;
+    const auto on_unsubscribe = ite->second->on_unsubscribe;
+    callback_map.erase(ite);
+    publish_dispatch_table();
+    last_slots.erase(id);
+    if (on_unsubscribe) {
+      on_unsubscribe(data);
+    }
+  } else {
+    // usually this means that our subscription request has been successfull
+    const auto ite = callback_map.find(id);
+    if (ite == callback_map.end()) return;
+    // keep the request alive while its callbacks run
+    const auto req = ite->second;
+    const bool restored = req->resubscribing;
+    req->subscribed = true;
+    req->resubscribing = false;
+    req->ws_id = data.at(result);
+    if (req->unsubscribing) {
+      // unsubscribe was called before the subscription id was known
+      send(req->get_unsubscription_request(req->ws_id).dump());
+    } else {
+      maps_wsid_to_id[req->ws_id] = id;
+      publish_dispatch_table();
+    }
+    // a restored subscription reports its gap instead
+    if (!restored) {
+      if (req->on_subscribe) req->on_subscribe(data);
+    } else if (on_gap) {
+      const auto last_slot = last_slots.find(id);
+      on_gap(id, last_slot == last_slots.end() ? 0 : last_slot->second);
+    }
   }
-  return sub_ite->second.cb;
 }
 
-/// @brief call the specified callback
-/// @param data the data recieved from websocket
-void session::call_callback(const json &data) {
-  // if params is not a key then return
-  std::string par = "params";
-  if (!data.contains(std::string{par})) {
-    return;
+/// @brief rebuild the dispatch table from the maps and publish it
+void session::publish_dispatch_table() {
+  std::vector<std::pair<uint64_t, std::shared_ptr<const RequestContent>>>
+      entries;
+  entries.reserve(maps_wsid_to_id.size());
+  for (const auto &[ws_id, id] : maps_wsid_to_id) {
+    const auto ite = callback_map.find(id);
+    if (ite != callback_map.end()) entries.emplace_back(ws_id, ite->second);
   }
+  confirmed_subscriptions.store(entries.size(), std::memory_order_relaxed);
+  std::unique_ptr<const DispatchTable> previous(
+      dispatch_table.exchange(new DispatchTable(entries)));
+  // a notification on the strand may still be reading the previous table
+  net::post(strand, [previous = std::move(previous)]() {});
+}
 
-  // if subscription is not a key in data["params"] then it's not relevant
-  std::string subscription = "subscription";
-  if (!data["params"].contains(std::string{subscription})) {
-    return;
+/// @brief call the callback of the subscription the notification is for
+/// @param subscription the subscription id of the notification
+/// @param slot the slot of the notification, 0 if it has none
+/// @param text the notification recieved from websocket
+void session::call_callback(RequestIdType subscription, uint64_t slot,
+                            std::string_view text) {
+  const auto table = dispatch_table.load(std::memory_order_acquire);
+  const auto req = table->find(subscription);
+  // we have already unsubscribed so no need to call the callback
+  if (req == nullptr) return;
+  notifications.fetch_add(1, std::memory_order_relaxed);
+  // keep the request alive while its callback runs
+  const auto request = *req;
+  if (slot != 0) last_slots[request->id] = slot;
+  // the server forgot the subscription already, so does the session, even if
+  // the callback throws
+  if (request->one_shot) {
+    maps_wsid_to_id.erase(request->ws_id);
+    callback_map.erase(request->id);
+    last_slots.erase(request->id);
+    publish_dispatch_table();
+  }
+  if (!dispatch_pool) {
+    invoke(*request, text);
+  } else {
+    // the frame is reused by the next read, workers get a copy
+    dispatch_pool->push({request->id, request, std::string(text)});
+    schedule_flush();
   }
-  // call the specified callback related to the subscription id
-  RequestIdType returned_sub = data["params"]["subscription"];
-  Callback cb = get_callback(returned_sub);
-  if (cb != nullptr) {
-    cb(data);
+}
+
+/// @brief run the callback of req with a notification
+void session::invoke(const RequestContent &req, std::string_view text) {
+  // raw callbacks decode the text themselves, only parse it for json ones
+  if (req.raw_cb != nullptr) {
+    req.raw_cb(text);
+  } else if (req.cb != nullptr) {
+    req.cb(json::parse(text));
   }
 }
 
+/// @brief retry handing conflated notifications to the dispatch pool until
+/// all of them are queued
+void session::schedule_flush() {
+  if (flush_scheduled || !dispatch_pool->flush()) return;
+  flush_scheduled = true;
+  flush_timer.expires_after(std::chrono::milliseconds(1));
+  flush_timer.async_wait([self = shared_from_this()](beast::error_code ec) {
+    self->flush_scheduled = false;
+    if (!ec) self->schedule_flush();
+  });
+}
+
 /// @brief close the connection from websocket
 /// @param ec the error code
 void session::on_close(beast::error_code ec) {
@@ -1,7 +1,11 @@
+#include <array>
+#include <atomic>
+#include <boost/beast/http.hpp>
 #include <boost/regex.hpp>
 #include <chrono>
 #include <cstdint>
 #include <ostream>
+#include <random>
 #include <string>
 #include <thread>
 
@@ -9,7 +13,14 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
 
+#include "HealthEngine.hpp"
+#include "HealthTracker.hpp"
+#include "LiquidationWatchlist.hpp"
 #include "MangoAccount.hpp"
+#include "accountCache.hpp"
+#include "conflated.hpp"
+#include "dispatchPool.hpp"
+#include "flatIdMap.hpp"
 
 const std::string KEY_PAIR_FILE = "../tests/fixtures/solana/id.json";
 const std::string DEVNET_GENESIS_HASH =
@@ -98,6 +109,85 @@ TEST_CASE("base58 decode & encode") {
   }
 }
 
+TEST_CASE("base58 PublicKey fast path") {
+  std::mt19937 gen(42);
+  for (size_t zeros = 0; zeros <= solana::PublicKey::SIZE; ++zeros) {
+    solana::PublicKey key;
+    for (auto& b : key.data) b = static_cast<uint8_t>(gen());
+    std::fill_n(key.data.begin(), zeros, 0);
+
+    char b58[solana::B58_32_MAX_SIZE];
+    const auto size = key.toBase58(b58);
+    CHECK_EQ(solana::b58encode(key.data), std::string(b58, size));
+    CHECK_EQ(key, solana::PublicKey::fromBase58(std::string(b58, size)));
+  }
+  CHECK_THROWS(solana::PublicKey::fromBase58(
+      "0ivtgssEBoBjuZJtSAPKYgpUK7DmnSwuPMqJoVTSgKJ"));
+  CHECK_THROWS(solana::PublicKey::fromBase58(
+      "4ivtgssEBoBjuZJtSAPKYgpUK7DmnSwuPMqJoVTSgKJ"));
+  CHECK_THROWS(solana::PublicKey::fromBase58(
+      "zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz"));
+}
+
+TEST_CASE("PublicKey hashing and interning") {
+  const auto a = solana::PublicKey::fromBase58(
+      "98pjRuQjK3qA6gXts96PqZT4Ze5QmnCmt3QYjhbUSPue");
+  const auto b = solana::PublicKey::fromBase58(
+      "mv3ekLzLbnVPNxjSKvqBpU3ZeZXPQdEC3bp5MDEBG68");
+  CHECK_NE(a, b);
+  CHECK((a < b) != (b < a));
+  CHECK_EQ(std::hash<solana::PublicKey>{}(a), solana::PublicKeyHash{}(a.data));
+  CHECK(solana::PublicKeyEqual{}(a, a.data));
+
+  solana::PublicKeyInterner interner;
+  CHECK_EQ(interner.intern(a), 0);
+  CHECK_EQ(interner.intern(b), 1);
+  CHECK_EQ(interner.intern(a), 0);
+  CHECK_EQ(interner.size(), 2);
+  const auto id = interner.find(b);
+  REQUIRE(id.has_value());
+  CHECK_EQ(*id, 1);
+  CHECK_FALSE(interner.find(solana::PublicKey::empty()).has_value());
+  CHECK_EQ(interner.key(1), b);
+}
+
+TEST_CASE("base64 kernels match scalar") {
+  std::mt19937 gen(42);
+  for (size_t size = 0; size < 300; ++size) {
+    std::string data(size, '\0');
+    for (auto& c : data) c = static_cast<char>(gen());
+    std::string expected(solana::b64encodedSize(size), '\0');
+    solana::b64encode(data.data(), size, &expected[0],
+                      solana::B64Kernel::SCALAR);
+    // '-' and '_' are decoded leniently by the scalar table only
+    std::string lenient = expected;
+    if (lenient.size() > 40) lenient[37] = '-', lenient[3] = '_';
+    std::string lenientExpected(lenient.size(), '\0');
+    lenientExpected.resize(solana::b64decode(lenient.data(), lenient.size(),
+                                             &lenientExpected[0],
+                                             lenientExpected.size()));
+
+    for (const auto kernel :
+         {solana::B64Kernel::SSE4, solana::B64Kernel::AVX2}) {
+      if (!solana::b64kernelSupported(kernel)) continue;
+      std::string encoded(expected.size(), '\0');
+      solana::b64encode(data.data(), size, &encoded[0], kernel);
+      CHECK_EQ(expected, encoded);
+
+      std::string decoded(size, '\0');
+      solana::b64decode(encoded.data(), encoded.size(), &decoded[0], kernel);
+      CHECK_EQ(data, decoded);
+
+      std::string lenientDecoded(lenientExpected.size(), '\0');
+      solana::b64decode(lenient.data(), lenient.size(), &lenientDecoded[0],
+                        kernel);
+      CHECK_EQ(lenientExpected, lenientDecoded);
+    }
+  }
+  char small[3];
+  CHECK_THROWS(solana::b64decode("AAAAAAAA", 8, small, sizeof(small)));
+}
+
 TEST_CASE("parse private keys") {
   std::string resources_dir = FIXTURES_DIR;
   const auto keypair =
@@ -137,6 +227,26 @@ TEST_CASE("decode mango_v3 Fill") {
   CHECK_EQ(event->quantity, 1);
 }
 
+TEST_CASE("i80f48 multiply and divide") {
+  CHECK_EQ((i80f48(1.5) * i80f48(-2.25)).to_double(), -3.375);
+  CHECK_EQ((i80f48(-7) / i80f48(2)).to_double(), -3.5);
+  CHECK_THROWS(i80f48(1) / i80f48(0));
+
+  // operands wider than 64 bits, expected raw values from python big ints
+  const auto raw = [](__int128 hi, uint64_t lo) {
+    return i80f48::from_base(hi << 64 | lo);
+  };
+  const auto a = raw(1883801101, 16102901943627573425ULL);
+  const auto b = -raw(64, 12345);
+  CHECK_EQ(to_string((a / b).to_raw()), "-8285044863706154839681");
+  const auto c = -raw(1LL << 36, 7);
+  const auto d = raw(0, 844424930131969);
+  CHECK_EQ(to_string((c / d).to_raw()), "-422550200076075966765609138406");
+  const auto e = raw(1LL << 26, 5);
+  const auto f = -raw(0, 1099511627779);
+  CHECK_EQ(to_string((e * f).to_raw()), "-4835703278471710838358017");
+}
+
 TEST_CASE("compile memo transaction") {
   const solana::Blockhash recentBlockhash = {};
   const auto feePayer = solana::PublicKey::fromBase58(
@@ -183,6 +293,32 @@ TEST_CASE("MangoAccount is correctly created") {
   const auto& account = mango_v3::MangoAccount(key, connection);
   CHECK(!(account.mangoAccountInfo.owner == solana::PublicKey::empty()));
 }
+TEST_CASE("MangoAccount loads open orders by market") {
+  const auto& config = mango_v3::MAINNET;
+  auto connection = solana::rpc::Connection(config.endpoint);
+  auto mangoAccount = mango_v3::MangoAccount(
+      solana::PublicKey::fromBase58(
+          "F3TTrgxjrkAHdS9zEidtwU5VXyvMgr5poii4HYatZheH"),
+      connection);
+  const auto& openOrders = mangoAccount.loadOpenOrders(connection);
+  for (size_t i = 0; i < mango_v3::MAX_PAIRS; ++i) {
+    const auto& key = mangoAccount.mangoAccountInfo.spotOpenOrders[i];
+    CHECK_EQ(openOrders[i].has_value(), !(key == solana::PublicKey::empty()));
+  }
+  // many accounts share requests of up to MAX_MULTIPLE_ACCOUNTS keys
+  std::vector<mango_v3::MangoAccount> accounts(
+      60, mango_v3::MangoAccount(mangoAccount.mangoAccountInfo));
+  mango_v3::MangoAccount::loadOpenOrders(connection, accounts);
+  for (const auto& account : accounts) {
+    for (size_t i = 0; i < mango_v3::MAX_PAIRS; ++i) {
+      REQUIRE_EQ(account.spotOpenOrdersAccounts[i].has_value(),
+                 openOrders[i].has_value());
+      if (!openOrders[i]) continue;
+      CHECK_EQ(account.spotOpenOrdersAccounts[i]->market,
+               openOrders[i]->market);
+    }
+  }
+}
 TEST_CASE("Test getMultipleAccountsInfo") {
   // Existing accounts
   std::vector<solana::PublicKey> accounts{
@@ -284,19 +420,9 @@ TEST_CASE("account1") {
   auto openOrders7 =
       solana::rpc::fromFile<serum_v3::OpenOrders>(path + "/openorders7.json");
 
-  auto get_address = [](const std::string& path) -> std::string {
-    std::ifstream fileStream(path);
-    std::string fileContent(std::istreambuf_iterator<char>(fileStream), {});
-    auto response = json::parse(fileContent);
-    return response["address"];
-  };
-
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders3.json")] =
-      openOrders3;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders6.json")] =
-      openOrders6;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders7.json")] =
-      openOrders7;
+  mangoAccount.spotOpenOrdersAccounts[3] = openOrders3;
+  mangoAccount.spotOpenOrdersAccounts[6] = openOrders6;
+  mangoAccount.spotOpenOrdersAccounts[7] = openOrders7;
 
   auto mangoCache =
       solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json");
@@ -334,17 +460,8 @@ TEST_CASE("account2") {
   auto openOrders3 =
       solana::rpc::fromFile<serum_v3::OpenOrders>(path + "/openorders3.json");
 
-  auto get_address = [](const std::string& path) -> std::string {
-    std::ifstream fileStream(path);
-    std::string fileContent(std::istreambuf_iterator<char>(fileStream), {});
-    auto response = json::parse(fileContent);
-    return response["address"];
-  };
-
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders2.json")] =
-      openOrders2;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders3.json")] =
-      openOrders3;
+  mangoAccount.spotOpenOrdersAccounts[2] = openOrders2;
+  mangoAccount.spotOpenOrdersAccounts[3] = openOrders3;
 
   auto mangoCache =
       solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json");
@@ -444,23 +561,11 @@ TEST_CASE("account5") {
   auto openOrders8 =
       solana::rpc::fromFile<serum_v3::OpenOrders>(path + "/openorders8.json");
 
-  auto get_address = [](const std::string& path) -> std::string {
-    std::ifstream fileStream(path);
-    std::string fileContent(std::istreambuf_iterator<char>(fileStream), {});
-    auto response = json::parse(fileContent);
-    return response["address"];
-  };
-
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders0.json")] =
-      openOrders0;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders1.json")] =
-      openOrders1;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders2.json")] =
-      openOrders2;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders3.json")] =
-      openOrders3;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders8.json")] =
-      openOrders8;
+  mangoAccount.spotOpenOrdersAccounts[0] = openOrders0;
+  mangoAccount.spotOpenOrdersAccounts[1] = openOrders1;
+  mangoAccount.spotOpenOrdersAccounts[2] = openOrders2;
+  mangoAccount.spotOpenOrdersAccounts[3] = openOrders3;
+  mangoAccount.spotOpenOrdersAccounts[8] = openOrders8;
 
   auto mangoCache =
       solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json");
@@ -504,23 +609,11 @@ TEST_CASE("account6") {
   auto openOrders8 =
       solana::rpc::fromFile<serum_v3::OpenOrders>(path + "/openorders8.json");
 
-  auto get_address = [](const std::string& path) -> std::string {
-    std::ifstream fileStream(path);
-    std::string fileContent(std::istreambuf_iterator<char>(fileStream), {});
-    auto response = json::parse(fileContent);
-    return response["address"];
-  };
-
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders0.json")] =
-      openOrders0;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders1.json")] =
-      openOrders1;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders2.json")] =
-      openOrders2;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders3.json")] =
-      openOrders3;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders8.json")] =
-      openOrders8;
+  mangoAccount.spotOpenOrdersAccounts[0] = openOrders0;
+  mangoAccount.spotOpenOrdersAccounts[1] = openOrders1;
+  mangoAccount.spotOpenOrdersAccounts[2] = openOrders2;
+  mangoAccount.spotOpenOrdersAccounts[3] = openOrders3;
+  mangoAccount.spotOpenOrdersAccounts[8] = openOrders8;
 
   auto mangoCache =
       solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json");
@@ -556,15 +649,7 @@ TEST_CASE("account7") {
   auto openOrders3 =
       solana::rpc::fromFile<serum_v3::OpenOrders>(path + "/openorders3.json");
 
-  auto get_address = [](const std::string& path) -> std::string {
-    std::ifstream fileStream(path);
-    std::string fileContent(std::istreambuf_iterator<char>(fileStream), {});
-    auto response = json::parse(fileContent);
-    return response["address"];
-  };
-
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders3.json")] =
-      openOrders3;
+  mangoAccount.spotOpenOrdersAccounts[3] = openOrders3;
 
   auto mangoCache =
       solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json");
@@ -600,15 +685,7 @@ TEST_CASE("account8") {
   auto openOrders3 =
       solana::rpc::fromFile<serum_v3::OpenOrders>(path + "/openorders3.json");
 
-  auto get_address = [](const std::string& path) -> std::string {
-    std::ifstream fileStream(path);
-    std::string fileContent(std::istreambuf_iterator<char>(fileStream), {});
-    auto response = json::parse(fileContent);
-    return response["address"];
-  };
-
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders3.json")] =
-      openOrders3;
+  mangoAccount.spotOpenOrdersAccounts[3] = openOrders3;
 
   auto mangoCache =
       solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json");
@@ -656,31 +733,13 @@ TEST_CASE("account9") {
   auto openOrders13 =
       solana::rpc::fromFile<serum_v3::OpenOrders>(path + "/openorders13.json");
 
-  auto get_address = [](const std::string& path) -> std::string {
-    std::ifstream fileStream(path);
-    std::string fileContent(std::istreambuf_iterator<char>(fileStream), {});
-    auto response = json::parse(fileContent);
-    return response["address"];
-  };
-
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders1.json")] =
-      openOrders1;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders5.json")] =
-      openOrders5;
-  mangoAccount.spotOpenOrdersAccounts[get_address(path + "/openorders6.json")] =
-      openOrders6;
-  mangoAccount
-      .spotOpenOrdersAccounts[get_address(path + "/openorders10.json")] =
-      openOrders10;
-  mangoAccount
-      .spotOpenOrdersAccounts[get_address(path + "/openorders11.json")] =
-      openOrders11;
-  mangoAccount
-      .spotOpenOrdersAccounts[get_address(path + "/openorders12.json")] =
-      openOrders12;
-  mangoAccount
-      .spotOpenOrdersAccounts[get_address(path + "/openorders13.json")] =
-      openOrders13;
+  mangoAccount.spotOpenOrdersAccounts[1] = openOrders1;
+  mangoAccount.spotOpenOrdersAccounts[5] = openOrders5;
+  mangoAccount.spotOpenOrdersAccounts[6] = openOrders6;
+  mangoAccount.spotOpenOrdersAccounts[10] = openOrders10;
+  mangoAccount.spotOpenOrdersAccounts[11] = openOrders11;
+  mangoAccount.spotOpenOrdersAccounts[12] = openOrders12;
+  mangoAccount.spotOpenOrdersAccounts[13] = openOrders13;
 
   auto mangoCache =
       solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json");
@@ -704,6 +763,248 @@ TEST_CASE("account9") {
   CHECK_FALSE(mangoAccount.isLiquidatable(mangoGroup, mangoCache));
 }
 
+namespace {
+/// @brief a tests/fixtures/mango_v3 directory, its OpenOrders loaded by
+/// market for the account and by address for the engine
+struct MangoFixture {
+  solana::PublicKey address;
+  mango_v3::MangoGroup group;
+  mango_v3::MangoCache cache;
+  mango_v3::MangoAccountInfo accountInfo;
+  mango_v3::MangoAccount account;
+  mango_v3::HealthEngine::OpenOrdersMap openOrders;
+};
+
+MangoFixture loadFixture(const std::string& name) {
+  const auto path = std::string(FIXTURES_DIR) + "/mango_v3/" + name;
+  std::ifstream accountStream(path + "/account.json");
+  const auto accountInfo = solana::rpc::fromFile<mango_v3::MangoAccountInfo>(
+      path + "/account.json");
+  MangoFixture fixture{
+      nlohmann::json::parse(accountStream)["address"].get<solana::PublicKey>(),
+      solana::rpc::fromFile<mango_v3::MangoGroup>(path + "/group.json"),
+      solana::rpc::fromFile<mango_v3::MangoCache>(path + "/cache.json"),
+      accountInfo,
+      mango_v3::MangoAccount(accountInfo),
+      {}};
+  for (int i = 0; i < mango_v3::MAX_PAIRS; ++i) {
+    const auto file = path + "/openorders" + std::to_string(i) + ".json";
+    std::ifstream fileStream(file);
+    if (!fileStream.good()) continue;
+    const auto address =
+        nlohmann::json::parse(fileStream)["address"].get<solana::PublicKey>();
+    fixture.account.spotOpenOrdersAccounts[i] =
+        solana::rpc::fromFile<serum_v3::OpenOrders>(file);
+    fixture.openOrders[address] = *fixture.account.spotOpenOrdersAccounts[i];
+  }
+  return fixture;
+}
+}  // namespace
+
+TEST_CASE("health summary, engine and tracker match per type queries") {
+  for (const std::string name :
+       {"empty", "1deposit", "account1", "account2", "account3", "account4",
+        "account5", "account6", "account7", "account8", "account9"}) {
+    const auto fixture = loadFixture(name);
+    const auto& mangoGroup = fixture.group;
+    const auto& mangoCache = fixture.cache;
+    const auto& accountInfo = fixture.accountInfo;
+    const auto& mangoAccount = fixture.account;
+    const auto& openOrders = fixture.openOrders;
+
+    const auto summary = mangoAccount.getHealthSummary(mangoGroup, mangoCache);
+    CHECK_EQ(summary.initHealth,
+             mangoAccount.getHealth(mangoGroup, mangoCache,
+                                    mango_v3::HealthType::Init));
+    CHECK_EQ(summary.maintHealth,
+             mangoAccount.getHealth(mangoGroup, mangoCache,
+                                    mango_v3::HealthType::Maint));
+    CHECK_EQ(summary.initHealthRatio,
+             mangoAccount.getHealthRatio(mangoGroup, mangoCache,
+                                         mango_v3::HealthType::Init));
+    CHECK_EQ(summary.maintHealthRatio,
+             mangoAccount.getHealthRatio(mangoGroup, mangoCache,
+                                         mango_v3::HealthType::Maint));
+
+    // health type resolved at compile time, weights from tables
+    const mango_v3::GroupWeights groupWeights(mangoGroup);
+    const auto initHealth =
+        mangoAccount.getHealth<mango_v3::HealthType::Init>(mangoGroup,
+                                                           mangoCache);
+    CHECK_EQ(initHealth, summary.initHealth);
+    const auto maintHealth = mangoAccount.getHealth(
+        mangoGroup, mangoCache,
+        groupWeights.get<mango_v3::HealthType::Maint>());
+    CHECK_EQ(maintHealth, summary.maintHealth);
+    const auto unknownHealth = mangoAccount.getHealth(
+        mangoGroup, mangoCache,
+        groupWeights.get<mango_v3::HealthType::Unknown>());
+    CHECK_EQ(unknownHealth,
+             mangoAccount.getHealth(mangoGroup, mangoCache,
+                                    mango_v3::HealthType::Unknown));
+
+    // the same account a few times, spread over threads
+    const mango_v3::HealthEngine engine(mangoGroup);
+    const std::vector<mango_v3::MangoAccountInfo> accounts(5, accountInfo);
+    for (const unsigned threads : {1, 3}) {
+      const auto results = engine.compute(
+          mangoCache, accounts, openOrders, threads);
+      REQUIRE_EQ(results.initHealth.size(), accounts.size());
+      for (size_t i = 0; i < accounts.size(); ++i) {
+        CHECK_EQ(results.initHealth[i], summary.initHealth);
+        CHECK_EQ(results.maintHealth[i], summary.maintHealth);
+      }
+    }
+
+    // only markets with changed cache entries are recomputed
+    mango_v3::HealthTracker tracker(mangoGroup, groupWeights, mangoAccount,
+                                    mangoCache);
+    CHECK_EQ(tracker.getHealth(mango_v3::HealthType::Init), summary.initHealth);
+    CHECK_EQ(tracker.getHealth(mango_v3::HealthType::Maint),
+             summary.maintHealth);
+    CHECK_EQ(tracker.update(mangoCache), 0);
+    auto nextCache = mangoCache;
+    nextCache.price_cache[1].price *= i80f48(1.1);
+    nextCache.perp_market_cache[2].long_funding += i80f48(3);
+    auto& quoteBank = nextCache.root_bank_cache[mango_v3::QUOTE_INDEX];
+    quoteBank.deposit_index *= i80f48(1.01);
+    // two markets and the quote bank
+    CHECK_EQ(tracker.update(nextCache), 3);
+    CHECK_EQ(tracker.getHealth(mango_v3::HealthType::Init),
+             mangoAccount.getHealth(mangoGroup, nextCache,
+                                    mango_v3::HealthType::Init));
+    CHECK_EQ(tracker.getHealth(mango_v3::HealthType::Maint),
+             mangoAccount.getHealth(mangoGroup, nextCache,
+                                    mango_v3::HealthType::Maint));
+    CHECK_EQ(tracker.isLiquidatable(),
+             mangoAccount.isLiquidatable(mangoGroup, nextCache));
+  }
+}
+
+TEST_CASE("liquidation watchlist ranks accounts by health") {
+  const auto groupFixture = loadFixture("account2");
+  const auto& mangoGroup = groupFixture.group;
+  auto mangoCache = groupFixture.cache;
+  // entries keep balances only, not the account with its loaded OpenOrders
+  CHECK_LT(sizeof(mango_v3::HealthTracker),
+           sizeof(mango_v3::MangoAccountInfo) + sizeof(serum_v3::OpenOrders));
+  mango_v3::LiquidationWatchlist watchlist(mangoGroup, mangoCache);
+  std::unordered_map<solana::PublicKey, mango_v3::MangoAccount> accounts;
+  for (const std::string name :
+       {"empty", "1deposit", "account1", "account2", "account3", "account4",
+        "account5", "account6", "account7", "account8", "account9"}) {
+    const auto fixture = loadFixture(name);
+    const auto& address = fixture.address;
+    const auto& mangoAccount = fixture.account;
+    // some fixtures are snapshots of the same account, the last one wins
+    watchlist.upsert(address, mangoAccount);
+    accounts.insert_or_assign(address, mangoAccount);
+  }
+  REQUIRE_EQ(watchlist.size(), accounts.size());
+
+  const auto checkRanking = [&]() {
+    const auto candidates = watchlist.topK(accounts.size() + 1);
+    REQUIRE_EQ(candidates.size(), accounts.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      const auto& mangoAccount = accounts.at(candidates[i].address);
+      const auto maintHealth = mangoAccount.getHealth(
+          mangoGroup, mangoCache, mango_v3::HealthType::Maint);
+      if (!mangoAccount.mangoAccountInfo.beingLiquidated) {
+        CHECK_EQ(candidates[i].liquidationHealth, maintHealth);
+      }
+      CHECK_EQ(candidates[i].isLiquidatable,
+               mangoAccount.isLiquidatable(mangoGroup, mangoCache));
+      if (i > 0) {
+        CHECK_LE(candidates[i - 1].liquidationHealth,
+                 candidates[i].liquidationHealth);
+      }
+    }
+  };
+  checkRanking();
+  CHECK_EQ(watchlist.topK(3).size(), 3);
+
+  mangoCache.price_cache[2].price *= i80f48(0.5);
+  CHECK_GT(watchlist.update(mangoCache), 0);
+  checkRanking();
+  CHECK_EQ(watchlist.update(mangoCache), 0);
+
+  // the quote bank alone moves the health of every account with quote
+  auto& quoteBank = mangoCache.root_bank_cache[mango_v3::QUOTE_INDEX];
+  quoteBank.deposit_index *= i80f48(0.9);
+  quoteBank.borrow_index *= i80f48(1.5);
+  CHECK_GT(watchlist.update(mangoCache), 0);
+  checkRanking();
+
+  const auto first = watchlist.topK(1).front().address;
+  CHECK(watchlist.erase(first));
+  CHECK_FALSE(watchlist.erase(first));
+  accounts.erase(first);
+  checkRanking();
+}
+
+TEST_CASE("price sensitivity predicts health after price moves") {
+  for (const std::string name :
+       {"1deposit", "account1", "account2", "account3", "account4", "account5",
+        "account6", "account7", "account8", "account9"}) {
+    const auto fixture = loadFixture(name);
+    const auto& mangoGroup = fixture.group;
+    const auto& mangoCache = fixture.cache;
+    const auto& accountInfo = fixture.accountInfo;
+    const auto& mangoAccount = fixture.account;
+    const auto& openOrders = fixture.openOrders;
+    const auto healthAt = [&](uint64_t market, i80f48 price) {
+      auto cache = mangoCache;
+      cache.price_cache[market].price = price;
+      return mangoAccount
+          .getHealth(mangoGroup, cache, mango_v3::HealthType::Maint)
+          .to_double();
+    };
+
+    const auto sensitivity = mangoAccount.getPriceSensitivity(
+        mangoGroup, mangoCache, mango_v3::HealthType::Maint);
+    CHECK_EQ(sensitivity.health,
+             mangoAccount.getHealth(mangoGroup, mangoCache,
+                                    mango_v3::HealthType::Maint));
+    const auto tolerance = 1e-6 * (1 + abs(sensitivity.health.to_double()));
+    for (uint64_t i = 0; i < mangoGroup.numOracles; ++i) {
+      // small moves keep positions and the worse open orders case
+      for (const auto factor : {0.99, 1.01}) {
+        const auto price = sensitivity.prices[i] * i80f48(factor);
+        CHECK_LE(abs(sensitivity.healthAt(i, price).to_double() -
+                     healthAt(i, price)),
+                 tolerance);
+      }
+      const auto liquidationPrice = sensitivity.liquidationPrice(i);
+      if (sensitivity.slopes[i] == 0) CHECK_FALSE(liquidationPrice);
+      if (liquidationPrice) {
+        const auto price = liquidationPrice.value();
+        CHECK_LE(abs(healthAt(i, price)), tolerance);
+      }
+    }
+
+    // batch over accounts and shocks
+    const mango_v3::HealthEngine engine(mangoGroup);
+    const std::vector<mango_v3::MangoAccountInfo> accounts(3, accountInfo);
+    std::vector<mango_v3::PriceSensitivity> sensitivities;
+    engine.computeSensitivity(mangoCache, accounts.data(), accounts.size(),
+                              openOrders, mango_v3::HealthType::Maint,
+                              sensitivities, 2);
+    REQUIRE_EQ(sensitivities.size(), accounts.size());
+    const auto shocked =
+        mango_v3::HealthEngine::healthUnderShocks(sensitivities, 0, {1, 0.9});
+    REQUIRE_EQ(shocked.size(), 2 * accounts.size());
+    for (size_t a = 0; a < accounts.size(); ++a) {
+      CHECK_EQ(sensitivities[a].health, sensitivity.health);
+      CHECK_EQ(shocked[a], sensitivity.health);
+      CHECK_LE(abs((shocked[accounts.size() + a] -
+                    sensitivity.healthAt(0, sensitivity.prices[0] *
+                                                i80f48(0.9)))
+                       .to_double()),
+               tolerance);
+    }
+  }
+}
+
 TEST_CASE("getVersion") {
   const auto connection = solana::rpc::Connection(solana::DEVNET);
   const auto version = connection.getVersion();
@@ -889,6 +1190,190 @@ TEST_CASE("account subscribe and unsubscribe") {
   CHECK(subscribe_called);
 }
 
+TEST_CASE("reconnect backoff grows with jitter up to the max delay") {
+  ReconnectPolicy policy{std::chrono::milliseconds(100),
+                         std::chrono::milliseconds(1000)};
+  std::mt19937 rng(42);
+  for (unsigned attempt = 0; attempt < 64; attempt++) {
+    const auto backoff = std::min<int64_t>(100 << std::min(attempt, 4u), 1000);
+    for (int i = 0; i < 100; i++) {
+      const auto delay = policy.delay(attempt, rng).count();
+      CHECK_GE(delay, backoff / 2);
+      CHECK_LE(delay, backoff);
+    }
+  }
+}
+
+TEST_CASE("parse websocket urls") {
+  using solana::rpc::subscription::parseWebSocketUrl;
+  const auto mainnet = parseWebSocketUrl("wss://api.mainnet-beta.solana.com");
+  CHECK(mainnet.tls);
+  CHECK_EQ(mainnet.host, "api.mainnet-beta.solana.com");
+  CHECK_EQ(mainnet.port, "443");
+  CHECK_EQ(mainnet.target, "/");
+  const auto local = parseWebSocketUrl("ws://127.0.0.1:8900/token/x");
+  CHECK_FALSE(local.tls);
+  CHECK_EQ(local.host, "127.0.0.1");
+  CHECK_EQ(local.port, "8900");
+  CHECK_EQ(local.target, "/token/x");
+  CHECK_THROWS_AS(parseWebSocketUrl("https://api.devnet.solana.com"),
+                  std::runtime_error);
+  CHECK_THROWS_AS(parseWebSocketUrl("wss://"), std::runtime_error);
+}
+
+TEST_CASE("flat id map finds every id") {
+  const solana::FlatIdMap<int> empty;
+  CHECK_EQ(empty.find(0), nullptr);
+
+  std::vector<std::pair<uint64_t, int>> entries;
+  std::mt19937_64 rng(7);
+  for (int i = 0; i < 1000; i++) entries.emplace_back(i, i);
+  for (int i = 0; i < 1000; i++) entries.emplace_back(rng() | 1ull << 63, i);
+  const solana::FlatIdMap<int> map(entries);
+  CHECK_EQ(map.size(), entries.size());
+  for (const auto& [id, value] : entries) {
+    const auto found = map.find(id);
+    REQUIRE(found != nullptr);
+    CHECK_EQ(*found, value);
+  }
+  CHECK_EQ(map.find(1000), nullptr);
+  CHECK_EQ(map.find(1ull << 62), nullptr);
+}
+
+namespace {
+struct SeqTask {
+  uint64_t key = 0;
+  uint64_t seq = 0;
+};
+
+/// @brief runs a pool whose workers stall until released, to fill queues
+struct StalledPool {
+  std::atomic<bool> released{false};
+  std::mutex mutex;
+  std::vector<SeqTask> received;
+  solana::DispatchPool<SeqTask> pool;
+
+  explicit StalledPool(solana::DispatchOptions options)
+      : pool(options, [this](SeqTask& task) {
+          while (!released.load()) std::this_thread::yield();
+          std::lock_guard lock(mutex);
+          received.push_back(task);
+        }) {}
+
+  void drain(size_t expected) {
+    released.store(true);
+    for (int i = 0; i < 1000; i++) {
+      {
+        std::lock_guard lock(mutex);
+        if (received.size() >= expected) return;
+      }
+      pool.flush();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+};
+}  // namespace
+
+TEST_CASE("dispatch pool keeps the order per key") {
+  StalledPool stalled({4, 16, solana::OverflowPolicy::Block});
+  stalled.released.store(true);
+  for (uint64_t seq = 0; seq < 8000; seq++) {
+    stalled.pool.push({seq % 8, seq});
+  }
+  stalled.drain(8000);
+  REQUIRE_EQ(stalled.received.size(), 8000);
+  std::vector<int64_t> last(8, -1);
+  bool ordered = true;
+  for (const auto& task : stalled.received) {
+    ordered = ordered && static_cast<int64_t>(task.seq) > last[task.key];
+    last[task.key] = task.seq;
+  }
+  CHECK(ordered);
+  CHECK_EQ(stalled.pool.stats().pushed, 8000);
+}
+
+TEST_CASE("dispatch pool drops the oldest tasks when full") {
+  StalledPool stalled({1, 4, solana::OverflowPolicy::DropOldest});
+  for (uint64_t seq = 0; seq < 100; seq++) stalled.pool.push({1, seq});
+  const auto dropped = stalled.pool.stats().dropped;
+  CHECK_GE(dropped, 90);
+  stalled.drain(100 - dropped);
+  REQUIRE_EQ(stalled.received.size(), 100 - dropped);
+  CHECK_EQ(stalled.received.back().seq, 99);
+}
+
+TEST_CASE("dispatch pool conflates to the latest task when full") {
+  StalledPool stalled({1, 4, solana::OverflowPolicy::Conflate});
+  for (uint64_t seq = 0; seq < 100; seq++) stalled.pool.push({seq % 2, seq});
+  const auto conflated = stalled.pool.stats().conflated;
+  CHECK_GE(conflated, 90);
+  stalled.drain(100 - conflated);
+  REQUIRE_EQ(stalled.received.size(), 100 - conflated);
+  CHECK_FALSE(stalled.pool.flush());
+  // the latest task of every key is delivered
+  std::vector<uint64_t> last(2, 0);
+  for (const auto& task : stalled.received) last[task.key] = task.seq;
+  CHECK_EQ(last[0], 98);
+  CHECK_EQ(last[1], 99);
+}
+
+TEST_CASE("dispatch pool survives callbacks throwing anything") {
+  std::atomic<uint64_t> handled{0};
+  solana::DispatchPool<SeqTask> pool(
+      {1, 16, solana::OverflowPolicy::Block}, [&](SeqTask& task) {
+        handled++;
+        if (task.seq % 2) throw task.seq;
+        throw std::runtime_error("callback failed");
+      });
+  for (uint64_t seq = 0; seq < 10; seq++) pool.push({0, seq});
+  for (int i = 0; i < 1000 && handled.load() < 10; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK_EQ(handled.load(), 10);
+}
+
+TEST_CASE("conflated keeps the latest slot") {
+  solana::Conflated<std::string> latest;
+  std::string value;
+  uint64_t slot = 0;
+  CHECK_FALSE(latest.take(value, slot));
+  CHECK(latest.publish(std::string("a"), 5));
+  CHECK_FALSE(latest.publish(std::string("stale"), 4));
+  CHECK(latest.publish(std::string("b"), 6));
+  REQUIRE(latest.take(value, slot));
+  CHECK_EQ(value, "b");
+  CHECK_EQ(slot, 6);
+  CHECK_FALSE(latest.take(value, slot));
+  CHECK_FALSE(latest.wait(value, slot, std::chrono::milliseconds(1)));
+  const auto counters = latest.counters();
+  CHECK_EQ(counters.updates, 2);
+  CHECK_EQ(counters.conflated, 1);
+  CHECK_EQ(counters.stale, 1);
+}
+
+TEST_CASE("conflated consumers only see newer values") {
+  solana::Conflated<uint64_t> latest;
+  std::thread producer([&]() {
+    for (uint64_t slot = 1; slot <= 100000; slot++) latest.publish(slot, slot);
+  });
+  uint64_t value = 0;
+  uint64_t slot = 0;
+  uint64_t taken = 0;
+  bool increasing = true;
+  while (value < 100000) {
+    const auto previous = value;
+    if (!latest.wait(value, slot, std::chrono::seconds(5))) break;
+    increasing = increasing && value > previous && value == slot;
+    taken++;
+  }
+  producer.join();
+  CHECK(increasing);
+  CHECK_EQ(value, 100000);
+  const auto counters = latest.counters();
+  CHECK_EQ(counters.updates, 100000);
+  CHECK_EQ(counters.updates, counters.conflated + taken);
+}
+
 TEST_CASE("getBlockTime") {
   const auto connection = solana::rpc::Connection(solana::DEVNET);
   const auto slot = connection.getFirstAvailableBlock();
@@ -1020,3 +1505,640 @@ TEST_CASE("getTokenAccountsByOwner") {
       solana::TokenAccountsByOwnerConfig{{}, "jsonParsed"});
   CHECK_GT(TokenAccountsByOwner.value.size(), 0);
 }
+
+/// @brief tcp server on a free localhost port, every connection is handled
+/// by on_connection on a thread of its own. Clients have to disconnect before
+/// the server is destroyed
+class LocalServer {
+ public:
+  explicit LocalServer(std::function<void(tcp::socket)> on_connection)
+      : acceptor_(ioc_, {net::ip::make_address("127.0.0.1"), 0}),
+        thread_([this, on_connection]() {
+          for (;;) {
+            tcp::socket socket(ioc_);
+            acceptor_.accept(socket);
+            if (stopped_.load()) return;
+            connections_.emplace_back(on_connection, std::move(socket));
+          }
+        }) {}
+
+  ~LocalServer() {
+    stopped_.store(true);
+    // unblock accept
+    tcp::socket wake(ioc_);
+    wake.connect(acceptor_.local_endpoint());
+    thread_.join();
+    for (auto& connection : connections_) connection.join();
+  }
+
+  std::string port() const {
+    return std::to_string(acceptor_.local_endpoint().port());
+  }
+
+ private:
+  net::io_context ioc_;
+  tcp::acceptor acceptor_;
+  std::atomic<bool> stopped_{false};
+  std::vector<std::thread> connections_;
+  std::thread thread_;
+};
+
+/// @brief answer json rpc requests over http with respond(request), batches
+/// element by element
+void serveJsonRpc(tcp::socket socket,
+                  const std::function<solana::json(const solana::json&)>&
+                      respond) {
+  beast::flat_buffer buffer;
+  beast::error_code ec;
+  for (;;) {
+    http::request<http::string_body> request;
+    http::read(socket, buffer, request, ec);
+    if (ec) return;
+    const auto body = solana::json::parse(request.body());
+    solana::json result = solana::json::array();
+    if (body.is_array()) {
+      for (const auto& element : body) result.push_back(respond(element));
+    } else {
+      result = respond(body);
+    }
+    http::response<http::string_body> response{http::status::ok,
+                                               request.version()};
+    response.set(http::field::content_type, "application/json");
+    response.keep_alive(request.keep_alive());
+    response.body() = result.dump();
+    response.prepare_payload();
+    http::write(socket, response, ec);
+    if (ec || !request.keep_alive()) return;
+  }
+}
+
+/// @brief json rpc response with result
+solana::json rpcResult(const solana::json& request, solana::json result) {
+  return {{"jsonrpc", "2.0"}, {"id", request["id"]}, {"result", result}};
+}
+
+TEST_CASE("async requests") {
+  const auto connection = solana::rpc::Connection(solana::DEVNET);
+  // keep many requests in flight from a single thread
+  std::vector<std::future<uint64_t>> slots;
+  for (int i = 0; i < 32; ++i) slots.push_back(connection.getSlotAsync());
+  auto genesisHash = connection.getGenesisHashAsync();
+  auto blockhash = connection.getLatestBlockhashAsync();
+  for (auto& slot : slots) CHECK_GT(slot.get(), 0);
+  CHECK_EQ(genesisHash.get(), DEVNET_GENESIS_HASH);
+  CHECK_GT(blockhash.get().lastValidBlockHeight, 0);
+  // completion handler
+  std::promise<solana::json> version;
+  connection.sendJsonRpcRequestAsync(
+      solana::rpc::jsonRequest("getVersion"),
+      [&version](std::exception_ptr error, solana::json res) {
+        if (error) return version.set_exception(error);
+        version.set_value(res);
+      });
+  CHECK(version.get_future().get().contains("solana-core"));
+  // rpc errors are forwarded to the future
+  auto invalid = connection.sendJsonRpcRequestAsync(
+      solana::rpc::jsonRequest("getInvalidMethod"));
+  CHECK_THROWS_AS(invalid.get(), std::runtime_error);
+}
+
+TEST_CASE("confirm transaction forwards malformed results") {
+  LocalServer server([](tcp::socket socket) {
+    serveJsonRpc(std::move(socket), [](const solana::json& request) {
+      if (request["method"] == "getLatestBlockhash") {
+        return rpcResult(
+            request,
+            {{"context", {{"slot", 1}}},
+             {"value",
+              {{"blockhash", "EtWTRABZaYq6iMfeYKouRu166VU2xqa1wcaWoxPkrZBG"},
+               {"lastValidBlockHeight", 100}}}});
+      }
+      // getBlockHeight
+      return rpcResult(request, nullptr);
+    });
+  });
+  const auto connection =
+      solana::rpc::Connection("http://127.0.0.1:" + server.port());
+  auto confirmed = connection.confirmTransactionAsync(
+      "signature", solana::Commitment::CONFIRMED, 3);
+  REQUIRE(confirmed.wait_for(std::chrono::seconds(10)) ==
+          std::future_status::ready);
+  // the parse error, not a broken promise
+  CHECK_THROWS_AS(confirmed.get(), solana::json::type_error);
+}
+
+TEST_CASE("batch requests") {
+  const auto connection = solana::rpc::Connection(mango_v3::DEVNET.endpoint);
+  auto batch = solana::rpc::BatchRequest(connection);
+  auto blockhash = batch.getLatestBlockhash();
+  auto account = batch.getAccountInfo<mango_v3::MangoAccountInfo>(
+      solana::PublicKey::fromBase58(
+          "9aWg1jhgRzGRmYWLbTrorCFE7BQbaz2dE5nYKmqeLGCW"));
+  auto statuses = batch.getSignatureStatuses(
+      {"5j7s6NiJS3JAkvgkoc18WVAsiSaci2pxB2A6ueCJP4tprA2TFg9wSyTLeYouxPBJEMzJ"
+       "inENTkpA52YStRW5Dia7"});
+  auto invalid = batch.add("getInvalidMethod");
+  CHECK_EQ(batch.size(), 4);
+  batch.send();
+  CHECK_EQ(batch.size(), 0);
+  CHECK_GT(blockhash.get().lastValidBlockHeight, 0);
+  CHECK(!(account.get().value.value().owner == solana::PublicKey::empty()));
+  CHECK_EQ(statuses.get().value.size(), 1);
+  // errors of single requests only fail their own future
+  CHECK_THROWS_AS(invalid.get(), std::runtime_error);
+}
+
+TEST_CASE("batch requests without a result fail their own future") {
+  LocalServer server([](tcp::socket socket) {
+    serveJsonRpc(std::move(socket), [](const solana::json& request) {
+      if (request["method"] == "getSlot") return rpcResult(request, 42);
+      return solana::json{{"jsonrpc", "2.0"}, {"id", request["id"]}};
+    });
+  });
+  const auto connection =
+      solana::rpc::Connection("http://127.0.0.1:" + server.port());
+  auto batch = solana::rpc::BatchRequest(connection);
+  auto slot = batch.add("getSlot");
+  auto missing = batch.add("getBlockHeight");
+  batch.send();
+  CHECK_EQ(slot.get(), 42);
+  CHECK_THROWS_AS(missing.get(), std::runtime_error);
+}
+
+TEST_CASE("account cache keeps the latest slot") {
+  const std::string resources_dir = FIXTURES_DIR;
+  std::ifstream fileStream(resources_dir + "/mango_v3/account2/cache.json");
+  const auto fixture = solana::json::parse(fileStream);
+  const auto notification = [&](uint64_t slot) {
+    return solana::json{
+        {"jsonrpc", "2.0"},
+        {"method", "accountNotification"},
+        {"params",
+         {{"result",
+           {{"context", {{"slot", slot}}},
+            {"value",
+             {{"data", fixture["data"]},
+              {"executable", false},
+              {"lamports", 1},
+              {"owner", mango_v3::MAINNET.program},
+              {"rentEpoch", 2}}}}},
+          {"subscription", 3}}}}
+        .dump();
+  };
+  using Cache = solana::rpc::subscription::AccountCache<mango_v3::MangoCache>;
+  Cache cache;
+  const auto key = solana::PublicKey::fromBase58(mango_v3::MAINNET.group);
+  const auto handle = cache.track(key);
+  CHECK_FALSE(handle.get().has_value());
+  CHECK_EQ(cache.size(), 1);
+
+  const auto later = Cache::decodeNotification(notification(5));
+  const auto earlier = Cache::decodeNotification(notification(4));
+  CHECK(cache.update(key, later));
+  CHECK_FALSE(cache.update(key, earlier));
+  CHECK(cache.update(key, later));
+  CHECK_FALSE(cache.update(solana::PublicKey::empty(), later));
+
+  const auto entry = handle.get();
+  REQUIRE(entry.has_value());
+  CHECK_EQ(entry->context.slot, 5);
+  CHECK_EQ(entry->value.rentEpoch, 2);
+  const auto expected = solana::rpc::fromFile<mango_v3::MangoCache>(
+      resources_dir + "/mango_v3/account2/cache.json");
+  CHECK_EQ(memcmp(&entry->value.data, &expected, sizeof(expected)), 0);
+  const auto byKey = cache.get(key);
+  REQUIRE(byKey.has_value());
+  CHECK_EQ(byKey->context.slot, 5);
+}
+
+TEST_CASE("seqlock readers never see torn values") {
+  using Value = std::array<uint64_t, 64>;
+  solana::Seqlock<Value> seqlock;
+  Value value;
+  CHECK_FALSE(seqlock.load(value));
+  std::atomic<bool> done{false};
+  std::atomic<int> torn{0};
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 2; ++r) {
+    readers.emplace_back([&]() {
+      Value read;
+      while (!done.load()) {
+        if (!seqlock.load(read)) continue;
+        for (const auto v : read) {
+          if (v != read[0]) torn++;
+        }
+      }
+    });
+  }
+  for (uint64_t i = 1; i <= 100000; ++i) {
+    value.fill(i);
+    seqlock.store(value);
+  }
+  done.store(true);
+  for (auto& reader : readers) reader.join();
+  CHECK_EQ(torn.load(), 0);
+  CHECK_EQ(seqlock.version(), 100000);
+  REQUIRE(seqlock.load(value));
+  CHECK_EQ(value[63], 100000);
+}
+
+TEST_CASE("decode account info response") {
+  std::string resources_dir = FIXTURES_DIR;
+  const auto path = resources_dir + "/mango_v3/account1/account.json";
+  std::ifstream fileStream(path);
+  const auto fixture = solana::json::parse(fileStream);
+  const std::string encoded = fixture["data"][0];
+  const std::string account =
+      R"({"data":[")" + encoded +
+      R"(","base64"],"executable":false,"lamports":30791040,)"
+      R"("owner":"mv3ekLzLbnVPNxjSKvqBpU3ZeZXPQdEC3bp5MDEBG68",)"
+      R"("rentEpoch":226,"space":4296})";
+  const auto expected =
+      solana::rpc::fromFile<mango_v3::MangoAccountInfo>(path);
+
+  const auto res =
+      solana::decodeAccountInfoResponse<mango_v3::MangoAccountInfo>(
+          R"({"jsonrpc":"2.0","result":{"context":{"apiVersion":"1.14.7",)"
+          R"("slot":134045296},"value":)" +
+          account + R"(},"id":1})");
+  CHECK_EQ(res.context.slot, 134045296);
+  REQUIRE(res.value.has_value());
+  CHECK_EQ(res.value->lamports, 30791040);
+  CHECK_EQ(res.value->rentEpoch, 226);
+  CHECK_FALSE(res.value->executable);
+  CHECK_EQ(res.value->owner.toBase58(), mango_v3::MAINNET.program);
+  CHECK_EQ(memcmp(&res.value->data, &expected, sizeof(expected)), 0);
+
+  const auto multiple =
+      solana::decodeMultipleAccountsInfoResponse<mango_v3::MangoAccountInfo>(
+          R"({"jsonrpc":"2.0","result":{"context":{"slot":1},"value":[)" +
+          account + R"(, null]},"id":1})");
+  REQUIRE_EQ(multiple.value.size(), 2);
+  CHECK_EQ(memcmp(&multiple.value[0]->data, &expected, sizeof(expected)), 0);
+  CHECK_FALSE(multiple.value[1].has_value());
+
+  const auto missing =
+      solana::decodeAccountInfoResponse<mango_v3::MangoAccountInfo>(
+          R"({"jsonrpc":"2.0","result":{"context":{"slot":1},"value":null},)"
+          R"("id":1})");
+  CHECK_FALSE(missing.value.has_value());
+  CHECK_THROWS_AS(
+      solana::decodeAccountInfoResponse<mango_v3::MangoCache>(
+          R"({"jsonrpc":"2.0","result":{"context":{"slot":1},"value":)" +
+          account + R"(},"id":1})"),
+      std::runtime_error);
+  CHECK_THROWS_AS(
+      solana::decodeAccountInfoResponse<mango_v3::MangoCache>(
+          R"({"jsonrpc":"2.0","error":{"code":-32602,"message":"x"},"id":1})"),
+      std::runtime_error);
+}
+
+TEST_CASE("decode account notification into a reused buffer") {
+  std::string resources_dir = FIXTURES_DIR;
+  const auto path = resources_dir + "/mango_v3/account1/account.json";
+  std::ifstream fileStream(path);
+  const auto fixture = solana::json::parse(fileStream);
+  const std::string encoded = fixture["data"][0];
+  const auto notification = [&](uint64_t slot, uint64_t lamports) {
+    // subscription may come before or after the result
+    return R"({"jsonrpc":"2.0","method":"accountNotification","params":{)"
+           R"("subscription":7,"result":{"context":{"slot":)" +
+           std::to_string(slot) + R"(},"value":{"data":[")" + encoded +
+           R"(","base64"],"executable":false,"lamports":)" +
+           std::to_string(lamports) +
+           R"(,"owner":"mv3ekLzLbnVPNxjSKvqBpU3ZeZXPQdEC3bp5MDEBG68",)"
+           R"("rentEpoch":226}}}})";
+  };
+  const auto expected =
+      solana::rpc::fromFile<mango_v3::MangoAccountInfo>(path);
+
+  solana::AccountInfo<mango_v3::MangoAccountInfo> info{};
+  const auto first =
+      solana::decodeAccountNotification(notification(5, 1), info);
+  CHECK_EQ(first, 5);
+  CHECK_EQ(info.lamports, 1);
+  CHECK_EQ(memcmp(&info.data, &expected, sizeof(expected)), 0);
+  const auto second =
+      solana::decodeAccountNotification(notification(6, 2), info);
+  CHECK_EQ(second, 6);
+  CHECK_EQ(info.lamports, 2);
+  CHECK_EQ(info.owner.toBase58(), mango_v3::MAINNET.program);
+  CHECK_EQ(memcmp(&info.data, &expected, sizeof(expected)), 0);
+
+  CHECK_THROWS_AS(solana::decodeAccountNotification(
+                      R"({"jsonrpc":"2.0","result":1,"id":1})", info),
+                  std::runtime_error);
+}
+
+TEST_CASE("shards spread accounts evenly and consistently") {
+  using solana::rpc::subscription::shardOf;
+  std::mt19937 gen(42);
+  std::vector<solana::PublicKey> keys(16000);
+  for (auto& key : keys) {
+    for (auto& byte : key.data) byte = gen();
+  }
+
+  std::vector<size_t> counts(8);
+  size_t moved = 0;
+  for (const auto& key : keys) {
+    const auto shard = shardOf(key, 8);
+    counts[shard]++;
+    const auto grown = shardOf(key, 9);
+    // a key only ever moves to the new shard
+    if (grown != shard) {
+      CHECK_EQ(grown, 8);
+      moved++;
+    }
+    CHECK_EQ(shardOf(key, 1), 0);
+  }
+  for (const auto count : counts) {
+    CHECK(count > 1800);
+    CHECK(count < 2200);
+  }
+  // the new shard takes about a ninth of the keys
+  CHECK(moved > 1600);
+  CHECK(moved < 1950);
+}
+
+TEST_CASE("decode subscription notifications") {
+  const auto notification = [](const std::string& method,
+                               const std::string& result) {
+    return R"({"jsonrpc":"2.0","method":")" + method +
+           R"(","params":{"result":)" + result + R"(,"subscription":3}})";
+  };
+
+  solana::SlotInfo slot{};
+  solana::decodeSlotNotification(
+      notification("slotNotification",
+                   R"({"parent":74,"root":43,"slot":75})"),
+      slot);
+  CHECK_EQ(slot.parent, 74);
+  CHECK_EQ(slot.root, 43);
+  CHECK_EQ(slot.slot, 75);
+
+  CHECK_EQ(solana::decodeRootNotification(notification("rootNotification",
+                                                       "42")),
+           42);
+
+  solana::SignatureResult signature;
+  CHECK_EQ(solana::decodeSignatureNotification(
+               notification("signatureNotification",
+                            R"({"context":{"slot":5207624},)"
+                            R"("value":{"err":null}})"),
+               signature),
+           5207624);
+  CHECK_FALSE(signature.err.has_value());
+  solana::decodeSignatureNotification(
+      notification("signatureNotification",
+                   R"({"context":{"slot":1},)"
+                   R"("value":{"err":{"InstructionError":[0,"Custom"]}}})"),
+      signature);
+  CHECK_EQ(signature.err.value(), R"({"InstructionError":[0,"Custom"]})");
+
+  solana::Logs logs;
+  CHECK_EQ(solana::decodeLogsNotification(
+               notification(
+                   "logsNotification",
+                   R"({"context":{"slot":5208469},"value":{"signature":"5h6x",)"
+                   R"("err":null,"logs":["Program log: \"quoted\"","done"]}})"),
+               logs),
+           5208469);
+  CHECK_EQ(logs.signature, "5h6x");
+  CHECK_FALSE(logs.err.has_value());
+  REQUIRE(logs.logs.size() == 2);
+  CHECK_EQ(logs.logs[0], R"(Program log: "quoted")");
+  CHECK_EQ(logs.logs[1], "done");
+
+  struct Counter {
+    uint64_t count;
+  };
+  const auto program = mango_v3::MAINNET.program;
+  solana::ProgramAccount<Counter> account{};
+  CHECK_EQ(solana::decodeProgramNotification(
+               notification(
+                   "programNotification",
+                   R"({"context":{"slot":5208469},"value":{"pubkey":")" +
+                       program +
+                       R"(","account":{"data":["AQAAAAAAAAA=","base64"],)"
+                       R"("executable":false,"lamports":33594,"owner":")" +
+                       program + R"(","rentEpoch":636}}})"),
+               account),
+           5208469);
+  CHECK_EQ(account.pubkey.toBase58(), program);
+  CHECK_EQ(account.account.lamports, 33594);
+  CHECK_EQ(account.account.data.count, 1);
+
+  solana::ProgramAccountFilters filters;
+  filters.dataSize = 8;
+  filters.memcmp.push_back({4, "3Mc6vR"});
+  CHECK_EQ(json(filters).dump(),
+           R"([{"dataSize":8},{"memcmp":{"bytes":"3Mc6vR","offset":4}}])");
+}
+
+/// @brief accountNotification frame for a subscription at slot
+std::string accountNotification(uint64_t subscription, uint64_t slot) {
+  return json{{"jsonrpc", "2.0"},
+              {"method", "accountNotification"},
+              {"params",
+               {{"result", {{"context", {{"slot", slot}}}, {"value", {}}}},
+                {"subscription", subscription}}}}
+      .dump();
+}
+
+TEST_CASE("subscriptions are restored with new ids after a reconnect") {
+  // the first connection confirms subscription 100, notifies slot 500 and
+  // drops, the second one confirms 101 and notifies slot 501
+  std::atomic<int> connections{0};
+  std::promise<void> first_notification;
+  auto first_notification_seen = first_notification.get_future().share();
+  std::promise<json> unsubscription;
+  LocalServer server([&](tcp::socket socket) {
+    const auto connection = connections++;
+    websocket::stream<tcp::socket> ws(std::move(socket));
+    ws.accept();
+    beast::flat_buffer buffer;
+    ws.read(buffer);
+    const auto request = json::parse(beast::buffers_to_string(buffer.data()));
+    buffer.consume(buffer.size());
+    const uint64_t subscription = 100 + connection;
+    ws.write(net::buffer(rpcResult(request, subscription).dump()));
+    // the id of the dropped connection is not routed anymore
+    if (connection == 1) ws.write(net::buffer(accountNotification(100, 600)));
+    ws.write(net::buffer(accountNotification(subscription, 500 + connection)));
+    if (connection == 0) {
+      first_notification_seen.wait_for(std::chrono::seconds(5));
+      return;
+    }
+    beast::error_code ec;
+    ws.read(buffer, ec);
+    if (ec) return;
+    const auto unsubscribe =
+        json::parse(beast::buffers_to_string(buffer.data()));
+    unsubscription.set_value(unsubscribe);
+    ws.write(net::buffer(rpcResult(unsubscribe, true).dump()), ec);
+    // until the client disconnects
+    while (!ec) ws.read(buffer, ec);
+  });
+
+  std::mutex mutex;
+  std::vector<uint64_t> slots;
+  std::vector<std::pair<RequestIdType, uint64_t>> gaps;
+  std::promise<void> restored;
+  std::atomic<int> subscribed{0};
+  {
+    solana::rpc::subscription::WebSocketSubscriber sub(
+        "127.0.0.1", server.port(), 5,
+        {std::chrono::milliseconds(10), std::chrono::milliseconds(100)});
+    sub.onGap([&](RequestIdType id, uint64_t last_slot) {
+      std::lock_guard<std::mutex> lock(mutex);
+      gaps.emplace_back(id, last_slot);
+    });
+    const auto id = sub.onAccountChange(
+        solana::PublicKey::empty(),
+        [&](const json& notification) {
+          std::lock_guard<std::mutex> lock(mutex);
+          slots.push_back(notification["params"]["result"]["context"]["slot"]);
+          if (slots.size() == 1) first_notification.set_value();
+          if (slots.size() == 2) restored.set_value();
+        },
+        solana::Commitment::FINALIZED,
+        [&](const json&) { subscribed++; });
+    REQUIRE_EQ(restored.get_future().wait_for(std::chrono::seconds(10)),
+               std::future_status::ready);
+
+    // unsubscribe goes out with the id of the new connection
+    sub.removeAccountChangeListener(id);
+    auto unsubscribe = unsubscription.get_future();
+    REQUIRE_EQ(unsubscribe.wait_for(std::chrono::seconds(5)),
+               std::future_status::ready);
+    const auto request = unsubscribe.get();
+    CHECK_EQ(request["method"], "accountUnsubscribe");
+    CHECK_EQ(request["params"], json::array({101}));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK_EQ(connections.load(), 2);
+    CHECK_EQ(subscribed.load(), 1);
+    CHECK_EQ(slots, std::vector<uint64_t>({500, 501}));
+    REQUIRE_EQ(gaps.size(), 1);
+    CHECK_EQ(gaps[0].first, id);
+    CHECK_EQ(gaps[0].second, 500);
+    CHECK_EQ(sub.health().reconnects, 1);
+  }
+}
+
+TEST_CASE("concurrent subscribes reach the server exactly once and in order") {
+  const size_t threads = 4;
+  const size_t per_thread = 2500;
+  std::promise<std::vector<RequestIdType>> all_received;
+  LocalServer server([&](tcp::socket socket) {
+    websocket::stream<tcp::socket> ws(std::move(socket));
+    ws.accept();
+    beast::flat_buffer buffer;
+    beast::error_code ec;
+    std::vector<RequestIdType> ids;
+    for (;;) {
+      ws.read(buffer, ec);
+      if (ec) return;
+      const auto request =
+          json::parse(beast::buffers_to_string(buffer.data()));
+      buffer.consume(buffer.size());
+      ids.push_back(request["id"]);
+      ws.write(net::buffer(rpcResult(request, ids.size()).dump()), ec);
+      if (ids.size() == threads * per_thread) all_received.set_value(ids);
+    }
+  });
+
+  std::atomic<size_t> subscribed{0};
+  {
+    solana::rpc::subscription::WebSocketSubscriber sub("127.0.0.1",
+                                                       server.port(), 5);
+    // subscribe from several threads at once, each sees its ids in order
+    std::vector<std::vector<RequestIdType>> issued(threads);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+      workers.emplace_back([&, t]() {
+        for (size_t i = 0; i < per_thread; i++) {
+          issued[t].push_back(sub.onAccountChange(
+              solana::PublicKey::empty(), [](const json&) {},
+              solana::Commitment::FINALIZED,
+              [&](const json&) { subscribed++; }));
+        }
+      });
+    }
+    for (auto& worker : workers) worker.join();
+
+    auto future = all_received.get_future();
+    REQUIRE_EQ(future.wait_for(std::chrono::seconds(60)),
+               std::future_status::ready);
+    const auto received = future.get();
+    std::unordered_map<RequestIdType, size_t> position;
+    for (size_t i = 0; i < received.size(); i++) position[received[i]] = i;
+    // every frame exactly once
+    CHECK_EQ(position.size(), threads * per_thread);
+    for (const auto& ids : issued) {
+      for (size_t i = 0; i < ids.size(); i++) {
+        const auto it = position.find(ids[i]);
+        REQUIRE(it != position.end());
+        // frames of one thread are written in the order it subscribed
+        if (i > 0) CHECK_LT(position[ids[i - 1]], it->second);
+      }
+    }
+
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (subscribed.load() < threads * per_thread &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK_EQ(subscribed.load(), threads * per_thread);
+    CHECK_EQ(sub.health().subscriptions, threads * per_thread);
+  }
+}
+
+TEST_CASE("one shot subscriptions end even if their callback throws") {
+  const auto signatureNotification = json{
+      {"jsonrpc", "2.0"},
+      {"method", "signatureNotification"},
+      {"params",
+       {{"result", {{"context", {{"slot", 5}}}, {"value", {{"err", nullptr}}}}},
+        {"subscription", 7}}}}.dump();
+  LocalServer server([&](tcp::socket socket) {
+    websocket::stream<tcp::socket> ws(std::move(socket));
+    ws.accept();
+    beast::flat_buffer buffer;
+    beast::error_code ec;
+    for (uint64_t subscription = 7; !ec; subscription++) {
+      ws.read(buffer, ec);
+      if (ec) return;
+      const auto request =
+          json::parse(beast::buffers_to_string(buffer.data()));
+      buffer.consume(buffer.size());
+      ws.write(net::buffer(rpcResult(request, subscription).dump()), ec);
+      // a second one for the finished signature subscription is dropped
+      ws.write(net::buffer(signatureNotification), ec);
+      if (subscription > 7) {
+        ws.write(net::buffer(accountNotification(subscription, 6)), ec);
+      }
+    }
+  });
+
+  std::atomic<int> calls{0};
+  std::promise<void> thrown;
+  std::promise<void> account_seen;
+  solana::rpc::subscription::WebSocketSubscriber sub("127.0.0.1",
+                                                     server.port(), 5);
+  sub.onSignature("5h6x", [&](const solana::SignatureResult&, uint64_t) {
+    calls++;
+    thrown.set_value();
+    throw std::runtime_error("callback failed");
+  });
+  REQUIRE_EQ(thrown.get_future().wait_for(std::chrono::seconds(5)),
+             std::future_status::ready);
+  // notifications are handled in order, so the duplicate is handled first
+  sub.onAccountChange(solana::PublicKey::empty(),
+                      [&](const json&) { account_seen.set_value(); });
+  REQUIRE_EQ(account_seen.get_future().wait_for(std::chrono::seconds(5)),
+             std::future_status::ready);
+  CHECK_EQ(calls.load(), 1);
+  CHECK_EQ(sub.health().subscriptions, 1);
+}